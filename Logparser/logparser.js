@@ -319,11 +319,19 @@ var match = [
 	{ re: "!TSF:SAN:FAIL", d: "Sanity check failed, attempt to re-initialize radio" },
 	{ re: "TSF:CRT:OK", d: "Clearing routing table successful" },
 	{ re: "TSF:LRT:OK", d: "Loading routing table successful" },
+	{ re: "TSF:SRT:OK,W=(\\d+)", d: "Saving routing table successful, <b>$1</b> changed routes written" },
 	{ re: "TSF:SRT:OK", d: "Saving routing table successful" },
 	{ re: "!TSF:RTE:FPAR ACTIVE", d: "Finding parent active, message not sent" },
 	{ re: "!TSF:RTE:(\\d+) UNKNOWN", d: "Routing for destination <b>$1</b> unknown, sending message to parent" },
 	{ re: "!TSF:RTE:N2N FAIL", d: "Direct node-to-node communication failed - handing over to parent" },
+	{ re: "TSF:RTE:(\\d+) FAILOVER,R=(\\d+)", d: "Next hop to node <b>$1</b> did not acknowledge, sending via alternate route <b>$2</b>" },
+	{ re: "!TSF:RTE:(\\d+) FAILOVER SKIP,R=(\\d+)", d: "Next hop to node <b>$1</b> did not acknowledge, alternate route <b>$2</b> has a worse or stale link, not used" },
 	{ re: "TSF:RRT:ROUTE N=(\\d+),R=(\\d+)", d: "Routing table, messages to node (<b>$1</b>) are routed via node (<b>$2</b>)"},
+	{ re: "TSF:RTX:OK,N=(\\d+)", d: "Routing table with <b>$1</b> routes exported" },
+	{ re: "!TSF:RTX:FAIL,N=(\\d+)", d: "Routing table export failed after <b>$1</b> routes" },
+	{ re: "TSF:RTI:OK,N=(\\d+),C=(\\d+),R=(\\d+)", d: "<b>$1</b> routes imported, <b>$2</b> of them cleared, <b>$3</b> records rejected" },
+	{ re: "!TSF:RTI:INVALID,N=(\\d+)", d: "Routing table import record for node <b>$1</b> rejected, invalid destination" },
+	{ re: "!TSF:RTI:LEN,(\\d+)", d: "Routing table import of length <b>$1</b> rejected, expected node and route tuples of 4 hex digits" },
 	{ re: "!TSF:SND:TNR", d: "Transport not ready, message cannot be sent" },
 	{ re: "TSF:TDI:TSL", d: "Set transport to sleep" },
 	{ re: "TSF:TDI:TPD", d: "Power down transport" },
@@ -383,7 +391,10 @@ var match = [
 	{ re: "SGN:PRE:NSUP,TO=(\\d+)", d: "Informing node <b>$1</b> that we do not support signing" },
 	{ re: "SGN:SGN:NCE REQ,TO=(\\d+)", d: "Nonce request transmitted to node <b>$1</b>" },
 	{ re: "!SGN:SGN:NCE REQ,TO=(\\d+) FAIL", d: "Nonce request not properly transmitted to node <b>$1</b>" },
+	{ re: "!SGN:SGN:NCE TMO,TO=(\\d+)", d: "Timeout waiting for nonce from node <b>$1</b>, queued message dropped" },
 	{ re: "!SGN:SGN:NCE TMO", d: "Timeout waiting for nonce" },
+	{ re: "SGN:SGN:QUE,TO=(\\d+)", d: "Message to node <b>$1</b> queued until the nonce for the previous message has been used" },
+	{ re: "!SGN:SGN:QUE FULL", d: "Message not sent, too many messages are waiting for a nonce" },
 	{ re: "SGN:SGN:SGN", d: "Message signed" },
 	{ re: "!SGN:SGN:SGN FAIL", d: "Message failed to be signed" },
 	{ re: "SGN:SGN:NREQ=(\\d+)", d: "Node <b>$1</b> does not require signed messages" },
@@ -402,6 +413,9 @@ var match = [
 	{ re: "!SGN:NCE:GEN", d: "Failed to generate nonce" },
 	{ re: "SGN:NCE:NSUP (DROPPED)", d: "Ignored nonce/request for nonce (signing not supported)" },
 	{ re: "SGN:NCE:FROM=(\\d+)", d: "Received nonce from node <b>$1</b>" },
+	{ re: "SGN:NCE:NREQ (DROPPED)", d: "Ignoring nonce as no message waits for a nonce from this node" },
+	{ re: "!SGN:NCE:TMR,ID=(\\d+)", d: "Nonce sent to node <b>$1</b> expired before a signed message arrived" },
+	{ re: "!SGN:NCE:DROP,ID=(\\d+)", d: "Nonce sent to node <b>$1</b> dropped, too many nodes are waiting to send signed messages" },
 	{ re: "SGN:NCE:(\\d+)!=(\\d+) (DROPPED)", d: "Ignoring nonce as it did not come from the desgination of the message to sign" },
 	{ re: "!SGN:BND:INIT FAIL", d: "Failed to initialize signing backend" },
 	{ re: "!SGN:BND:PWD<8", d: "Signing password too short" },
@@ -411,7 +425,7 @@ var match = [
 	{ re: "!SGN:BND:SIG,SIZE,(\\d+)>(\\d+)", d: "Refusing to sign message with length <b>$1</b> because it is bigger than allowed size <b>$2</b> " },
 	{ re: "SGN:BND:SIG WHI,ID=(\\d+)", d: "Salting message with our id <b>$1</b>" },
 	{ re: "SGN:BND:SIG WHI,SERIAL=(.*)", d: "Salting message with our serial <b>$1</b>" },
-	{ re: "!SGN:BND:VER ONGOING", d: "Verification failed, no ongoing session" },
+	{ re: "!SGN:BND:VER NONCE,ID=(\\d+)", d: "Verification failed, no unexpired nonce was sent to node <b>$1</b>" },
 	{ re: "!SGN:BND:VER,IDENT=(\\d+)", d: "Verification failed, identifier <b>$1</b> is unknown" },
 	{ re: "SGN:BND:VER WHI,ID=(\\d+)", d: "Id <b>$1</b> found in whitelist" },
 	{ re: "SGN:BND:VER WHI,SERIAL=(.*)", d: "Expecting serial <b>$1</b> for this sender" },
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+#
+# The MySensors Arduino library handles the wireless radio link and protocol
+# between your home built sensors/actuators and HA controller of choice.
+# The sensors forms a self healing radio network with optional repeaters. Each
+# repeater and gateway builds a routing tables in EEPROM which keeps track of the
+# network topology allowing messages to be routed to nodes.
+#
+# Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+# Copyright (C) 2013-2020 Sensnology AB
+# Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+#
+# Documentation: http://www.mysensors.org
+# Support Forum: http://forum.mysensors.org
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# version 2 as published by the Free Software Foundation.
+#
+"""Decode MY_DEBUG_TRACE output (see core/MyTrace.h) into the usual debug text.
+
+The format strings are collected from the PSTR() literals of the library sources, and of any
+additional directories given with --source (e.g. the sketch). Text that is not part of a trace
+record is passed through. The output can be pasted into logparser.html.
+
+  tracedecode.py /tmp/mysgw.trace
+  tracedecode.py --source ~/MySketch /dev/ttyUSB0
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+RECORD_START = 0xFE
+
+# printf conversion, with the length modifiers the hash leaves out
+CONVERSION = re.compile(r'%([-+ #0-9.*]*)[hlLqjzt]*([a-zA-Z%])')
+LITERAL = re.compile(r'\s*"((?:[^"\\]|\\.)*)"')
+PRI_MACRO = re.compile(r'\s*PRI([diouxX])\w*')
+
+
+def fnv1a(text):
+    h = 2166136261
+    for c in text.encode('latin-1'):
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def canonical(fmt):
+    return CONVERSION.sub(r'%\1\2', fmt)
+
+
+def pstr_formats(source):
+    """Yield the format strings of all PSTR("..." PRIu8 "...") in source."""
+    for match in re.finditer(r'\bPSTR\(', source):
+        pos = match.end()
+        parts = []
+        while True:
+            literal = LITERAL.match(source, pos)
+            if literal:
+                parts.append(literal.group(1).encode('latin-1').decode('unicode_escape'))
+                pos = literal.end()
+                continue
+            macro = PRI_MACRO.match(source, pos)
+            if macro:
+                parts.append(macro.group(1))
+                pos = macro.end()
+                continue
+            break
+        if parts:
+            yield ''.join(parts)
+
+
+def load_formats(directories):
+    formats = {}
+    for directory in directories:
+        for root, _, files in os.walk(directory):
+            for name in files:
+                if os.path.splitext(name)[1] not in ('.c', '.cpp', '.h', '.ino'):
+                    continue
+                with open(os.path.join(root, name), encoding='latin-1') as f:
+                    for fmt in pstr_formats(f.read()):
+                        fmt = canonical(fmt)
+                        formats[fnv1a(fmt)] = fmt
+    return formats
+
+
+class Truncated(Exception):
+    pass
+
+
+def varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise Truncated()
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def zigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_record(data, pos, fmt):
+    """Decode the arguments of fmt at pos, return the text and the position after the record."""
+    args = []
+    pyfmt = []
+    last = 0
+    for conv in CONVERSION.finditer(fmt):
+        flags, kind = conv.groups()
+        pyfmt.append(fmt[last:conv.start()])
+        last = conv.end()
+        for _ in range(flags.count('*')):
+            value, pos = varint(data, pos)
+            args.append(zigzag(value))
+        if kind == '%':
+            pyfmt.append('%%')
+            continue
+        value, pos = varint(data, pos)
+        if kind in 'di':
+            args.append(zigzag(value))
+        elif kind == 's':
+            if pos + value > len(data):
+                raise Truncated()
+            args.append(data[pos:pos + value].decode('latin-1'))
+            pos += value
+        elif kind in 'fFeEgG':
+            args.append(struct.unpack('<f', struct.pack('<I', value))[0])
+        else:
+            args.append(value)
+            if kind == 'p':
+                flags = '#' + flags
+                kind = 'x'
+        pyfmt.append('%' + flags + kind)
+    pyfmt.append(fmt[last:])
+    return ''.join(pyfmt) % tuple(args), pos
+
+
+class Decoder:
+    def __init__(self, formats, out):
+        self.formats = formats
+        self.out = out
+        self.millis = 0
+        self.skipping = False
+
+    def decode(self, data):
+        """Write the decoded data, return the number of bytes of an incomplete record at the end."""
+        pos = 0
+        text = bytearray()
+        while pos < len(data):
+            if data[pos] != RECORD_START:
+                if not self.skipping:
+                    text.append(data[pos])
+                pos += 1
+                continue
+            self.skipping = False
+            if text:
+                self.out.write(text.decode('latin-1'))
+                text.clear()
+            try:
+                if pos + 5 > len(data):
+                    raise Truncated()
+                ident = struct.unpack_from('<I', data, pos + 1)[0]
+                delta, end = varint(data, pos + 5)
+                fmt = self.formats.get(ident)
+                if fmt is None:
+                    # Without the format the record length is unknown, look for the next one
+                    self.millis += delta
+                    self.out.write('%d ?TRACE:ID=%08X\n' % (self.millis, ident))
+                    self.skipping = True
+                    pos += 1
+                    continue
+                line, pos = decode_record(data, end, fmt)
+            except Truncated:
+                return len(data) - pos
+            self.millis += delta
+            self.out.write('%d %s' % (self.millis, line))
+        if text:
+            self.out.write(text.decode('latin-1'))
+        return 0
+
+
+def main():
+    library = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--source', action='append', default=[],
+                        help='additional directory to collect format strings from')
+    parser.add_argument('input', nargs='?', help='trace file or serial device (default: stdin)')
+    options = parser.parse_args()
+
+    formats = load_formats([library] + options.source)
+    if options.input:
+        stream = open(options.input, 'rb')
+    else:
+        stream = sys.stdin.buffer
+    decoder = Decoder(formats, sys.stdout)
+    pending = b''
+    with stream:
+        while True:
+            chunk = stream.read1(4096) if hasattr(stream, 'read1') else stream.read(4096)
+            if not chunk:
+                break
+            data = pending + chunk
+            left = decoder.decode(data)
+            pending = data[len(data) - left:] if left else b''
+            sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
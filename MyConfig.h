@@ -118,6 +118,47 @@
  */
 //#define MY_OTA_LOG_SENDER_FEATURE
 
+/**
+ * @def MY_DEBUG_TRACE
+ * @brief Define MY_DEBUG_TRACE to write debug prints as compact binary trace records.
+ *
+ * Instead of formatting each debug print, only an id of the format string and the raw arguments
+ * are written. This takes a fraction of the CPU time, flash bandwidth and serial bandwidth of
+ * formatted output. Records are collected in a buffer of @ref MY_DEBUG_TRACE_BUFFER_SIZE bytes.
+ * The buffer is written to MY_DEBUGDEVICE when the node is idle, or when it runs full.
+ * On Linux, it is written to @ref MY_LINUX_TRACE_FILE.
+ *
+ * Decode the output offline with Logparser/tracedecode.py. It needs the library sources to find
+ * the format strings.
+ *
+ * A serial gateway needs a separate MY_DEBUGDEVICE. Has no effect with @ref MY_DEBUG_OTA.
+ */
+//#define MY_DEBUG_TRACE
+
+/**
+ * @def MY_DEBUG_TRACE_BUFFER_SIZE
+ * @brief Size (in bytes) of the @ref MY_DEBUG_TRACE record buffer, at least MY_SERIAL_OUTPUT_SIZE.
+ */
+#ifndef MY_DEBUG_TRACE_BUFFER_SIZE
+#define MY_DEBUG_TRACE_BUFFER_SIZE (128u)
+#endif
+
+/**
+ * @def MY_DEBUG_LATENCY
+ * @brief Define MY_DEBUG_LATENCY to measure the time messages spend in each stage of the message path.
+ *
+ * Radio to controller: HAL receive, signature verification, routing, gateway message format and
+ * gateway write. Controller to radio: message read and parse, gateway queue, routing, signing and
+ * HAL send. The times are collected in histograms, the median, 90th and 99th percentiles and the
+ * maximum (in microseconds) are printed on request:
+ * - Linux: send SIGUSR1 to the gateway, the percentiles are written to the log.
+ * - Nodes: I_DEBUG 'L' with @ref MY_SPECIAL_DEBUG, see there.
+ *
+ * With @ref MY_LINUX_GATEWAY_THREADED, the gateway stages are not timed, the radio to controller
+ * path ends at the hand over to the I/O thread.
+ */
+//#define MY_DEBUG_LATENCY
+
 /**
  * @def MY_SPECIAL_DEBUG
  * @brief Define MY_SPECIAL_DEBUG to enable support for I_DEBUG messages.
@@ -126,9 +167,21 @@
  * data. The request can be one of the following:
  * - 'R': routing info (only repeaters): received msg XXYY (as stream), where XX is the node and YY
  *   the routing node
+ * - 'T': routing table export (only repeaters): received msgs (as stream) with a header byte, the
+ *   frame number with bit 7 set in the last frame, followed by up to 8 tuples NNRRQQ of node,
+ *   routing node and link quality (share of acknowledged messages to the routing node, 255 = all,
+ *   0 = unknown, see @ref MY_ROUTING_ALTERNATES_FEATURE)
+ * - 'W': routing table import (only repeaters): 'W' followed by up to 6 tuples NNRR of node and
+ *   routing node, as hex digits (FF as routing node clears the route). Tuples with other
+ *   characters than hex digits, or node 00, FF or the repeater itself, are rejected. Responds
+ *   with "imported,rejected", the number of imported (including cleared) routes and of rejected
+ *   tuples. The routes are saved to EEPROM with the next routing table save.
  * - 'V': CPU voltage
  * - 'F': CPU frequency
  * - 'M': free memory
+ * - 'L': message path latency (with @ref MY_DEBUG_LATENCY): one message per stage (as stream), the
+ *   stage followed by the count, median, 90th and 99th percentile and maximum in microseconds
+ *   (uint32_t, little endian). The percentiles are printed to the debug output as well.
  * - 'E': clear MySensors EEPROM area and reboot (i.e. "factory" reset)
  */
 //#define MY_SPECIAL_DEBUG
@@ -1080,22 +1133,89 @@
  * @def MY_RAM_ROUTING_TABLE_FEATURE
  * @brief If enabled, the routing table is kept in RAM (if memory allows) and saved in regular
  *        intervals.
- * @note Enabled by default on most platforms, but on AVR only for atmega1280, atmega1284 and
- *       atmega2560.
- * @see MY_DISABLE_RAM_ROUTING_TABLE_FEATURE
+ *
+ * Only the routes changed since the last save are written to EEPROM. Where the routing table does
+ * not fit into RAM, the @ref MY_RAM_ROUTING_CACHE_SIZE most recently used routes are cached
+ * instead, changed routes are written when they are replaced in the cache, or saved in regular
+ * intervals.
+ * @note Enabled by default. The routing table is kept in RAM on most platforms, but on AVR only
+ *       for atmega1280, atmega1284 and atmega2560.
+ * @see MY_DISABLE_RAM_ROUTING_TABLE_FEATURE, MY_ROUTING_TABLE_SAVE_INTERVAL_MS
  */
 #ifndef MY_DISABLE_RAM_ROUTING_TABLE_FEATURE
 #define MY_RAM_ROUTING_TABLE_FEATURE
 #endif
 
+/**
+ * @def MY_RAM_ROUTING_CACHE_SIZE
+ * @brief Number of routes cached in RAM if the RAM routing table does not fit, 3 bytes each.
+ * @see MY_RAM_ROUTING_TABLE_FEATURE
+ */
+#ifndef MY_RAM_ROUTING_CACHE_SIZE
+#define MY_RAM_ROUTING_CACHE_SIZE (16u)
+#endif
+
 /**
  * @def MY_ROUTING_TABLE_SAVE_INTERVAL_MS
- * @brief Interval to dump content of routing table to EEPROM
+ * @brief Interval to save changed routes of the RAM routing table or cache to EEPROM
  */
 #ifndef MY_ROUTING_TABLE_SAVE_INTERVAL_MS
 #define MY_ROUTING_TABLE_SAVE_INTERVAL_MS (30*60*1000ul)
 #endif
 
+/**
+ * @def MY_ROUTING_ALTERNATES_FEATURE
+ * @brief If enabled, gateways and repeaters keep an alternate route per node and fail over to it.
+ *
+ * When a node is heard through another next hop than its route, the new hop becomes the route
+ * and the previous one is kept as alternate. If a routed message is not acknowledged by the next
+ * hop, it is sent to the alternate, which becomes the route if that succeeds. An alternate whose
+ * link is stale or worse than the one of the route (delivery, then RSSI) is not used.
+ *
+ * The link quality of each neighbour (share of acknowledged messages, i.e. 1/ETX, and RSSI) and
+ * the age of each route are tracked as well. Alternates and neighbours are kept in RAM only, in
+ * tables of @ref MY_ROUTING_ALTERNATES_SIZE and @ref MY_ROUTING_NEIGHBOURS_SIZE entries; the
+ * least recently heard entry is replaced when a table is full. A table of 255 entries covers all
+ * node ids and is indexed by node id instead of searched.
+ */
+//#define MY_ROUTING_ALTERNATES_FEATURE
+
+/**
+ * @def MY_ROUTING_ALTERNATES_SIZE
+ * @brief Number of nodes with an alternate route, 6 bytes each.
+ */
+#ifndef MY_ROUTING_ALTERNATES_SIZE
+#if defined(__linux__)
+#define MY_ROUTING_ALTERNATES_SIZE (255u)
+#elif defined(ARDUINO_ARCH_AVR)
+#define MY_ROUTING_ALTERNATES_SIZE (16u)
+#else
+#define MY_ROUTING_ALTERNATES_SIZE (64u)
+#endif
+#endif
+
+/**
+ * @def MY_ROUTING_NEIGHBOURS_SIZE
+ * @brief Number of neighbours (next hops) with link quality, 5 bytes each.
+ */
+#ifndef MY_ROUTING_NEIGHBOURS_SIZE
+#if defined(__linux__)
+#define MY_ROUTING_NEIGHBOURS_SIZE (255u)
+#elif defined(ARDUINO_ARCH_AVR)
+#define MY_ROUTING_NEIGHBOURS_SIZE (8u)
+#else
+#define MY_ROUTING_NEIGHBOURS_SIZE (32u)
+#endif
+#endif
+
+/**
+ * @def MY_ROUTING_ALTERNATE_MAX_AGE_MIN
+ * @brief Alternate routes not heard from for this many minutes are not used for fail over.
+ */
+#ifndef MY_ROUTING_ALTERNATE_MAX_AGE_MIN
+#define MY_ROUTING_ALTERNATE_MAX_AGE_MIN (24*60u)
+#endif
+
 /**
  * @def MY_REPEATER_FEATURE
  * @brief Enables repeater functionality (relays messages from other nodes)
@@ -1180,6 +1300,32 @@
 #define MY_TRANSPORT_WAIT_READY_MS (0)
 #endif
 
+/**
+ * @def MY_TRANSPORT_RX_PROCESS_BUDGET
+ * @brief Max number of radio messages processed before controller messages get their turn.
+ *
+ * On gateways, radio and controller messages are processed in alternating turns of their budget
+ * (see @ref MY_GATEWAY_RX_PROCESS_BUDGET) while either has messages pending, until
+ * @ref MY_PROCESS_TIME_BUDGET_MS is used up. The turns of a source that has a backlog, i.e. still
+ * has messages pending at the end of its turn, double up to four times its budget until it is
+ * drained. Nodes process one turn of this budget per call of _process().
+ */
+#ifndef MY_TRANSPORT_RX_PROCESS_BUDGET
+#define MY_TRANSPORT_RX_PROCESS_BUDGET (5u)
+#endif
+
+/**
+ * @def MY_PROCESS_TIME_BUDGET_MS
+ * @brief Time (in ms) a gateway spends processing pending messages before returning to the
+ *        sketch loop().
+ *
+ * The remaining messages are processed in the next call, starting with the source that was
+ * cut off. A turn that has started is always completed.
+ */
+#ifndef MY_PROCESS_TIME_BUDGET_MS
+#define MY_PROCESS_TIME_BUDGET_MS (10u)
+#endif
+
 /**
 * @def MY_SIGNAL_REPORT_ENABLED
 * @brief Enables signal report functionality.
@@ -1315,6 +1461,19 @@
 #define MY_OTA_FLASH_JDECID (0x1F65)
 #endif
 
+/**
+ * @def MY_OTA_COMPRESSION_FEATURE
+ * @brief Define this to accept compressed and delta encoded FW images.
+ *
+ * The encoded image is staged at MY_OTA_ENCODED_OFFSET and decoded into the FW image
+ * once received, images that would reach MY_OTA_ENCODED_OFFSET once decoded are rejected.
+ * Delta images copy from the installed FW and are only supported on AVR.
+ * Requires a controller supporting the FOTA 3.2 protocol extensions, otherwise the raw
+ * image is transferred.
+ * @note When using @ref MY_OTA_USE_I2C_EEPROM, a 24(L)C512 is needed as minimum.
+ */
+//#define MY_OTA_COMPRESSION_FEATURE
+
 /**
  * @def MY_DISABLE_REMOTE_RESET
  * @brief Disables over-the-air reset of node
@@ -1347,11 +1506,53 @@
 /**
  * @def MY_GATEWAY_MAX_CLIENTS
  * @brief Max number of parallel clients (sever mode).
+ *
+ * On Linux only clients with pending input are visited, this can be raised to hundreds.
  */
 #ifndef MY_GATEWAY_MAX_CLIENTS
 #define MY_GATEWAY_MAX_CLIENTS (1u)
 #endif
 
+/**
+ * @def MY_GATEWAY_RX_QUEUE_SIZE
+ * @brief Number of controller messages the gateway can hold before processing them.
+ *
+ * Each queued message takes sizeof(MyMessage) bytes of RAM.
+ */
+#ifndef MY_GATEWAY_RX_QUEUE_SIZE
+#if defined(MY_GATEWAY_LINUX)
+#define MY_GATEWAY_RX_QUEUE_SIZE (32u)
+#else
+#define MY_GATEWAY_RX_QUEUE_SIZE (4u)
+#endif
+#endif
+
+/**
+ * @def MY_GATEWAY_RX_PROCESS_BUDGET
+ * @brief Max number of queued controller messages processed before radio messages get their turn.
+ *
+ * Turns alternate while messages are pending, so radio traffic and the sketch loop() are not
+ * starved by a burst of controller commands (see @ref MY_TRANSPORT_RX_PROCESS_BUDGET).
+ */
+#ifndef MY_GATEWAY_RX_PROCESS_BUDGET
+#if defined(MY_GATEWAY_LINUX)
+#define MY_GATEWAY_RX_PROCESS_BUDGET (8u)
+#else
+#define MY_GATEWAY_RX_PROCESS_BUDGET (MY_GATEWAY_RX_QUEUE_SIZE)
+#endif
+#endif
+
+/**
+ * @def MY_GATEWAY_CLIENT_LINE_BUDGET
+ * @brief Linux ethernet gateway: max number of lines read from one controller connection in a row.
+ *
+ * A client sending faster than the lines are processed would otherwise hold on to the gateway,
+ * the other connections get their turn after this many lines.
+ */
+#ifndef MY_GATEWAY_CLIENT_LINE_BUDGET
+#define MY_GATEWAY_CLIENT_LINE_BUDGET (8u)
+#endif
+
 /**
  * @def MY_INCLUSION_MODE_FEATURE
  * @brief Define this to enable the inclusion mode feature.
@@ -2204,6 +2405,157 @@
 #ifndef MY_LINUX_CONFIG_FILE
 #define MY_LINUX_CONFIG_FILE "/etc/mysensors.conf"
 #endif
+
+/**
+ * @def MY_LINUX_EVENT_LOOP_TIMEOUT_MS
+ * @brief Maximum time (in ms) the main loop sleeps while waiting for events.
+ *
+ * The gateway blocks until controller data, a radio interrupt or a transport timer is due.
+ * This sets an upper bound, i.e. loop() is called at least once per timeout. The default keeps
+ * the 10ms loop() cadence of earlier releases for sketches polling sensors or timers in loop().
+ *
+ * Set it to e.g. 1000 to let an idle gateway sleep. A sketch can then still be woken up by
+ * registering its own file descriptors with eventLoopAdd(), by calling eventLoopWakeup() from
+ * another thread, or by sleeping with wait() until its next deadline.
+ */
+#ifndef MY_LINUX_EVENT_LOOP_TIMEOUT_MS
+#define MY_LINUX_EVENT_LOOP_TIMEOUT_MS (10ul)
+#endif
+
+/**
+ * @def MY_LINUX_RADIO_POLL_INTERVAL_MS
+ * @brief Radio polling interval (in ms) if the radio cannot signal incoming data by IRQ.
+ *
+ * Applies to RF24 without @ref MY_RF24_IRQ_PIN.
+ */
+#ifndef MY_LINUX_RADIO_POLL_INTERVAL_MS
+#define MY_LINUX_RADIO_POLL_INTERVAL_MS (10ul)
+#endif
+
+/**
+ * @def MY_LINUX_EEPROM_FLUSH_DELAY_MS
+ * @brief Time (in ms) EEPROM changes are collected before they are written to the eeprom_file.
+ *
+ * Each write-back replaces the file atomically. Changes of the last interval are lost on a power
+ * failure. Pending changes are written on SIGINT/SIGTERM. The checksum of the values is kept in
+ * the eeprom_file with ".crc" appended, the eeprom_file itself stays readable by older versions.
+ *
+ * 0 writes every change through. Each change, down to a single hwWriteConfig() byte, then costs
+ * two file replacements with an fsync() each, which is slow and wears out SD cards.
+ */
+#ifndef MY_LINUX_EEPROM_FLUSH_DELAY_MS
+#define MY_LINUX_EEPROM_FLUSH_DELAY_MS (5000ul)
+#endif
+
+/**
+ * @def MY_LINUX_TRACE_FILE
+ * @brief File the @ref MY_DEBUG_TRACE records are appended to.
+ */
+#ifndef MY_LINUX_TRACE_FILE
+#define MY_LINUX_TRACE_FILE "/tmp/mysgw.trace"
+#endif
+
+/**
+ * @def MY_LINUX_LOG_QUEUE_SIZE
+ * @brief Number of log lines queued for the log writer thread.
+ *
+ * Logging only formats the line, timestamps and output are handled by the writer thread. Lines
+ * are dropped and counted when the queue is full. Set to 0 to log synchronously.
+ */
+#ifndef MY_LINUX_LOG_QUEUE_SIZE
+#define MY_LINUX_LOG_QUEUE_SIZE (1024u)
+#endif
+
+/**
+ * @def MY_LINUX_METRICS
+ * @brief Define this to collect gateway metrics and serve them over HTTP in the Prometheus format.
+ *
+ * Covers per node message and failure counts and RSSI, gateway queues, the time from radio
+ * reception to the controller and the time the main loop is busy. The counters are updated by
+ * the main loop without locking, a scrape costs one snapshot formatted by the main loop.
+ */
+//#define MY_LINUX_METRICS
+
+/**
+ * @def MY_LINUX_METRICS_PORT
+ * @brief Port the @ref MY_LINUX_METRICS are served on, at http://<gateway>:<port>/metrics.
+ */
+#ifndef MY_LINUX_METRICS_PORT
+#define MY_LINUX_METRICS_PORT (9330u)
+#endif
+
+/**
+ * @def MY_LINUX_OTA_CACHE
+ * @brief Define this to cache FW images on the gateway and answer FW block requests locally.
+ *
+ * The images are taken from the responses of the controller, keyed by FW type and version.
+ * Set ota_cache_file in the config file to keep them across restarts.
+ */
+//#define MY_LINUX_OTA_CACHE
+
+/**
+ * @def MY_LINUX_OTA_CACHE_IMAGES
+ * @brief Number of FW images kept by the @ref MY_LINUX_OTA_CACHE.
+ */
+#ifndef MY_LINUX_OTA_CACHE_IMAGES
+#define MY_LINUX_OTA_CACHE_IMAGES (4u)
+#endif
+
+/**
+ * @def MY_LINUX_OTA_CACHE_IMAGE_SIZE
+ * @brief Max size of a FW image kept by the @ref MY_LINUX_OTA_CACHE, in bytes.
+ */
+#ifndef MY_LINUX_OTA_CACHE_IMAGE_SIZE
+#define MY_LINUX_OTA_CACHE_IMAGE_SIZE (0x40000ul)
+#endif
+
+/**
+ * @def MY_LINUX_OTA_MULTICAST
+ * @brief Define this to broadcast cached FW blocks while several nodes fetch the same image.
+ *
+ * Nodes accept broadcast blocks of the FW they are updating to and only request missing
+ * blocks, other nodes drop them. Repeaters only relay broadcast blocks of an image a child
+ * requested through them within the last 10 seconds. Requires @ref MY_LINUX_OTA_CACHE.
+ */
+//#define MY_LINUX_OTA_MULTICAST
+
+/**
+ * @def MY_LINUX_GATEWAY_THREADED
+ * @brief Define this to run the controller side of an Ethernet or MQTT gateway on a thread of its own.
+ *
+ * The main thread keeps the radio, routing and sketch. Slow controller clients then no longer
+ * stall radio reception, and radio transmissions no longer stall the controller connections.
+ */
+//#define MY_LINUX_GATEWAY_THREADED
+
+/**
+ * @def MY_LINUX_GATEWAY_QUEUE_SIZE
+ * @brief Number of messages queued in each direction between the threads.
+ *
+ * Requires @ref MY_LINUX_GATEWAY_THREADED. Messages to the controller are dropped when
+ * the queue is full.
+ */
+#ifndef MY_LINUX_GATEWAY_QUEUE_SIZE
+#define MY_LINUX_GATEWAY_QUEUE_SIZE (64u)
+#endif
+
+/**
+ * @def MY_LINUX_GATEWAY_TX_QUEUE_SIZE
+ * @brief Bytes queued per controller client of an Ethernet gateway that does not keep up.
+ *
+ * Writes to controller clients never block. When a client's queue is full its oldest
+ * messages are dropped, or it is disconnected with @ref MY_LINUX_GATEWAY_SLOW_CLIENT_DISCONNECT.
+ */
+#ifndef MY_LINUX_GATEWAY_TX_QUEUE_SIZE
+#define MY_LINUX_GATEWAY_TX_QUEUE_SIZE (8192u)
+#endif
+
+/**
+ * @def MY_LINUX_GATEWAY_SLOW_CLIENT_DISCONNECT
+ * @brief Define this to disconnect controller clients that exceed @ref MY_LINUX_GATEWAY_TX_QUEUE_SIZE
+ * instead of dropping their oldest messages.
+ */
+//#define MY_LINUX_GATEWAY_SLOW_CLIENT_DISCONNECT
 /** @}*/ // End of LinuxSettingGrpPub group
 /** @}*/ // End of PlatformSettingGrpPub group
 
@@ -2232,6 +2584,50 @@
 #define MY_NODE_TYPE "NODE"
 #endif
 
+// SIGNING, the defaults depend on the node type
+/**
+ * @def MY_SIGNING_PENDING_SIZE
+ * @brief Number of messages to sign that can wait for their nonce without blocking the sender.
+ *
+ * The nonce is requested and the send call returns, the message is signed and sent when the
+ * nonce arrives, so messages to several nodes are signed in parallel. Messages to the same node
+ * wait for the previous one. The send call returns @c true once the message is queued. The message
+ * is sent to the next hop chosen when it was queued, failover and the uplink failure counter only
+ * see the final result, which is also passed to signedSendComplete(). Each entry takes
+ * sizeof(MyMessage) + 7 bytes of RAM.
+ *
+ * Set to 0 to wait for the nonce in the send call, which is the default for nodes so that send()
+ * reports the delivery. Gateways default to 4 entries, Linux gateways to 32.
+ */
+#ifndef MY_SIGNING_PENDING_SIZE
+#if defined(MY_GATEWAY_LINUX)
+#define MY_SIGNING_PENDING_SIZE (32u)
+#elif defined(MY_GATEWAY_FEATURE)
+#define MY_SIGNING_PENDING_SIZE (4u)
+#else
+#define MY_SIGNING_PENDING_SIZE (0u)
+#endif
+#endif
+
+/**
+ * @def MY_SIGNING_NONCE_CACHE_SIZE
+ * @brief Number of nodes that can have a nonce for a signed message outstanding at the same time.
+ *
+ * Each node that requests a nonce gets its own entry with its own @ref MY_VERIFICATION_TIMEOUT_MS,
+ * so concurrent signed messages from several nodes can be verified. When all entries are in use the
+ * oldest nonce is dropped. Each entry takes 38 bytes of RAM. Defaults to 32 on Linux, 4 on other
+ * gateways and repeaters and 1 on nodes.
+ */
+#ifndef MY_SIGNING_NONCE_CACHE_SIZE
+#if defined(__linux__)
+#define MY_SIGNING_NONCE_CACHE_SIZE (32u)
+#elif defined(MY_GATEWAY_FEATURE) || defined(MY_REPEATER_FEATURE)
+#define MY_SIGNING_NONCE_CACHE_SIZE (4u)
+#else
+#define MY_SIGNING_NONCE_CACHE_SIZE (1u)
+#endif
+#endif
+
 // DEBUG
 #if defined(MY_DISABLED_SERIAL) && !defined(MY_DEBUG_OTA)
 #undef MY_DEBUG
@@ -2247,8 +2643,13 @@
 #if defined(MY_DEBUG) || defined(MY_DEBUG_VERBOSE_CORE) || defined(MY_DEBUG_VERBOSE_TRANSPORT) || defined(MY_DEBUG_VERBOSE_GATEWAY) || defined(MY_DEBUG_VERBOSE_SIGNING) || defined(MY_DEBUG_VERBOSE_OTA_UPDATE) || defined(MY_DEBUG_VERBOSE_RF24) || defined(MY_DEBUG_VERBOSE_NRF5_ESB) || defined(MY_DEBUG_VERBOSE_RFM69) || defined(MY_DEBUG_VERBOSE_RFM95) || defined(MY_DEBUG_VERBOSE_TRANSPORT_HAL)
 #define DEBUG_OUTPUT_ENABLED	//!< DEBUG_OUTPUT_ENABLED
 #ifndef MY_DEBUG_OTA
+#if defined(MY_DEBUG_TRACE)
+#define DEBUG_OUTPUT(x,...)		traceEvent(x, ##__VA_ARGS__)	//!< debug
+#else
 #define DEBUG_OUTPUT(x,...)		hwDebugPrint(x, ##__VA_ARGS__)	//!< debug
+#endif
 #else
+#undef MY_DEBUG_TRACE
 #ifndef MY_OTA_LOG_SENDER_FEATURE
 #define MY_OTA_LOG_SENDER_FEATURE
 #endif
@@ -2265,6 +2666,7 @@
 #undef MY_DEBUG_VERBOSE_RFM95
 #endif
 #else
+#undef MY_DEBUG_TRACE
 #define DEBUG_OUTPUT(x,...)								//!< debug NULL
 #endif
 
@@ -2344,10 +2746,15 @@
 #define MY_DEBUGDEVICE
 #define MY_DEBUG_OTA
 #define MY_DEBUG_OTA_DISABLE_ECHO
+#define MY_DEBUG_TRACE
+#define MY_DEBUG_LATENCY
 #define MY_SPECIAL_DEBUG
 #define MY_DISABLED_SERIAL
 #define MY_SPLASH_SCREEN_DISABLED
 // linux
+#define MY_LINUX_METRICS
+#define MY_LINUX_OTA_CACHE
+#define MY_LINUX_OTA_MULTICAST
 #define MY_LINUX_SERIAL_PORT
 #define MY_LINUX_SERIAL_IS_PTY
 #define MY_LINUX_SERIAL_GROUPNAME
@@ -2382,6 +2789,7 @@
 #define MY_INDICATION_HANDLER
 #define MY_DISABLE_REMOTE_RESET
 #define MY_DISABLE_RAM_ROUTING_TABLE_FEATURE
+#define MY_ROUTING_ALTERNATES_FEATURE
 #define MY_LOCK_DEVICE
 #define MY_SLEEP_HANDLER
 // core
@@ -2434,6 +2842,7 @@
 #define MY_ENCRYPTION_FEATURE
 // FOTA update
 #define MY_DEBUG_VERBOSE_OTA_UPDATE
+#define MY_OTA_COMPRESSION_FEATURE
 #define MY_OTA_USE_I2C_EEPROM
 // RS485
 #define MY_RS485
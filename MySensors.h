@@ -50,6 +50,17 @@
 #if defined(MY_OTA_LOG_SENDER_FEATURE) || defined(MY_OTA_LOG_RECEIVER_FEATURE)
 #include "core/MyOTALogging.h"
 #endif
+#if defined(MY_DEBUG_TRACE)
+#include "core/MyTrace.h"
+#endif
+#if defined(MY_LINUX_METRICS)
+#include "core/MyMetrics.h"
+#endif
+#if defined(MY_LINUX_OTA_CACHE)
+#include "core/MyOTAFirmwareCache.h"
+#endif
+// Latency macros expand to nothing without MY_DEBUG_LATENCY
+#include "core/MyLatency.h"
 
 // HARDWARE
 #include "hal/architecture/MyHwHAL.h"
@@ -106,10 +117,20 @@
 #define MAX max //!< MAX
 #endif
 
+#if !defined(hwMicros)
+#define hwMicros() micros() //!< hwMicros
+#endif
+
 // OTA Debug second part, depends on HAL
 #if defined(MY_OTA_LOG_SENDER_FEATURE) || defined(MY_OTA_LOG_RECEIVER_FEATURE)
 #include "core/MyOTALogging.cpp"
 #endif
+#if defined(MY_DEBUG_TRACE)
+#include "core/MyTrace.cpp"
+#endif
+#if defined(MY_DEBUG_LATENCY)
+#include "core/MyLatency.cpp"
+#endif
 
 #if defined(MY_LEDS_BLINKING_FEATURE)
 #error MY_LEDS_BLINKING_FEATURE is now removed from MySensors core,\
@@ -218,7 +239,12 @@ MY_DEFAULT_RX_LED_PIN in your sketch instead to enable LEDs
 #include "hal/architecture/Linux/drivers/core/IPAddress.h"
 #endif
 #include "drivers/PubSubClient/PubSubClient.cpp"
+#if defined(MY_LINUX_GATEWAY_THREADED)
+#define MY_LINUX_GATEWAY_THREADED_TRANSPORT "MyGatewayTransportMQTTClient.cpp"
+#include "core/MyGatewayTransportThreaded.cpp"
+#else
 #include "core/MyGatewayTransportMQTTClient.cpp"
+#endif
 #elif defined(MY_GATEWAY_FEATURE)
 // GATEWAY - COMMON FUNCTIONS
 #include "core/MyGatewayTransport.cpp"
@@ -241,7 +267,12 @@ MY_DEFAULT_RX_LED_PIN in your sketch instead to enable LEDs
 #include "hal/architecture/Linux/drivers/core/EthernetClient.h"
 #include "hal/architecture/Linux/drivers/core/EthernetServer.h"
 #include "hal/architecture/Linux/drivers/core/IPAddress.h"
+#if defined(MY_LINUX_GATEWAY_THREADED)
+#define MY_LINUX_GATEWAY_THREADED_TRANSPORT "MyGatewayTransportEthernet.cpp"
+#include "core/MyGatewayTransportThreaded.cpp"
+#else
 #include "core/MyGatewayTransportEthernet.cpp"
+#endif
 #elif defined(MY_GATEWAY_W5100)
 // GATEWAY - W5100
 #include "core/MyGatewayTransportEthernet.cpp"
@@ -253,6 +284,9 @@ MY_DEFAULT_RX_LED_PIN in your sketch instead to enable LEDs
 #include "core/MyGatewayTransportEthernet.cpp"
 #elif defined(MY_GATEWAY_SERIAL)
 // GATEWAY - SERIAL
+#if defined(MY_LINUX_GATEWAY_THREADED)
+#error MY_LINUX_GATEWAY_THREADED is not available for the serial gateway
+#endif
 #include "core/MyGatewayTransportSerial.cpp"
 #endif
 #endif
@@ -324,6 +358,14 @@ MY_DEFAULT_RX_LED_PIN in your sketch instead to enable LEDs
  * @see MY_RAM_ROUTING_TABLE_FEATURE
  */
 #define MY_RAM_ROUTING_TABLE_ENABLED
+/**
+ * @def MY_RAM_ROUTING_CACHE_ENABLED
+ * @brief Automatically set if the RAM routing table does not fit and recently used routes are
+ * cached instead
+ *
+ * @see MY_RAM_ROUTING_TABLE_FEATURE, MY_RAM_ROUTING_CACHE_SIZE
+ */
+#define MY_RAM_ROUTING_CACHE_ENABLED
 #elif defined(MY_RAM_ROUTING_TABLE_FEATURE) && defined(MY_REPEATER_FEATURE)
 // activate feature based on architecture
 #if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_NRF5) || defined(ARDUINO_ARCH_STM32F1) || defined(TEENSYDUINO) || defined(__linux__)
@@ -335,10 +377,28 @@ MY_DEFAULT_RX_LED_PIN in your sketch instead to enable LEDs
 #else
 // memory limited, enable with care
 // #define MY_RAM_ROUTING_TABLE_ENABLED
+// cache recently used routes instead
+#define MY_RAM_ROUTING_CACHE_ENABLED
 #endif // __avr_atmega1280__, __avr_atmega1284__, __avr_atmega2560__
-#endif // ARDUINO_ARCH_AVR
+#else
+// unknown memory size, cache recently used routes
+#define MY_RAM_ROUTING_CACHE_ENABLED
+#endif // architecture
 #endif // DOXYGEN
 
+// ALTERNATE ROUTES
+#ifdef DOXYGEN
+/**
+ * @def MY_ROUTING_ALTERNATES_ENABLED
+ * @brief Automatically set if alternate routes are enabled
+ *
+ * @see MY_ROUTING_ALTERNATES_FEATURE
+ */
+#define MY_ROUTING_ALTERNATES_ENABLED
+#elif defined(MY_ROUTING_ALTERNATES_FEATURE) && defined(MY_REPEATER_FEATURE)
+#define MY_ROUTING_ALTERNATES_ENABLED
+#endif
+
 // SOFTSERIAL
 #if defined(MY_GSM_TX) != defined(MY_GSM_RX)
 #error Both, MY_GSM_TX and MY_GSM_RX need to be defined when using SoftSerial
@@ -442,6 +502,12 @@ MY_DEFAULT_RX_LED_PIN in your sketch instead to enable LEDs
 #include "core/MyMessage.cpp"
 #include "core/MySplashScreen.cpp"
 #include "core/MySensorsCore.cpp"
+#if defined(MY_LINUX_METRICS)
+#include "core/MyMetrics.cpp"
+#endif
+#if defined(MY_LINUX_OTA_CACHE)
+#include "core/MyOTAFirmwareCache.cpp"
+#endif
 
 // HW mains
 #if defined(ARDUINO_ARCH_AVR)
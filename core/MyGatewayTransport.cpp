@@ -18,6 +18,7 @@
  */
 
 #include "MyGatewayTransport.h"
+#include "drivers/CircularBuffer/CircularBuffer.h"
 
 extern bool transportSendRoute(MyMessage &message);
 
@@ -25,10 +26,58 @@ extern bool transportSendRoute(MyMessage &message);
 extern MyMessage _msg;
 extern MyMessage _msgTmp;
 
-inline void gatewayTransportProcess(void)
+static MyMessage _gatewayRxQueueStorage[MY_GATEWAY_RX_QUEUE_SIZE];
+static CircularBuffer<MyMessage> _gatewayRxQueue(_gatewayRxQueueStorage,
+        MY_GATEWAY_RX_QUEUE_SIZE);
+static gatewayTransportRxQueueStats_t _gatewayRxQueueStats;
+#if defined(MY_DEBUG_LATENCY)
+// hwMicros() when the message in the same slot was queued
+static uint32_t _gatewayRxQueueMicros[MY_GATEWAY_RX_QUEUE_SIZE];
+#endif
+
+static void gatewayTransportQueueMessages(void)
+{
+	MyMessage *slot;
+#if defined(MY_DEBUG_LATENCY)
+	uint32_t readStart = hwMicros();
+#endif
+	while ((slot = _gatewayRxQueue.getFront()) != NULL && gatewayTransportAvailable()) {
+		*slot = gatewayTransportReceive();
+#if defined(MY_DEBUG_LATENCY)
+		const uint32_t queued = hwMicros();
+		latencyObserve(LATENCY_TX_PARSE, queued - readStart);
+		_gatewayRxQueueMicros[slot - _gatewayRxQueueStorage] = queued;
+		readStart = queued;
+#endif
+		(void)_gatewayRxQueue.pushFront(slot);
+		_gatewayRxQueueStats.received++;
+	}
+	const uint8_t depth = _gatewayRxQueue.available();
+	if (depth > _gatewayRxQueueStats.maxDepth) {
+		_gatewayRxQueueStats.maxDepth = depth;
+	}
+}
+
+const gatewayTransportRxQueueStats_t *gatewayTransportGetRxQueueStats(void)
 {
-	if (gatewayTransportAvailable()) {
-		_msg = gatewayTransportReceive();
+	_gatewayRxQueueStats.depth = _gatewayRxQueue.available();
+	return &_gatewayRxQueueStats;
+}
+
+bool gatewayTransportProcess(const uint8_t budget)
+{
+	gatewayTransportQueueMessages();
+	for (uint8_t processed = 0; processed < budget; processed++) {
+		const MyMessage *queued = _gatewayRxQueue.getBack();
+		if (queued == NULL) {
+			return false;
+		}
+		// copy out first, processing may re-enter via wait()
+		_msg = *queued;
+		LATENCY_BEGIN_AT(LATENCY_PATH_TX, _gatewayRxQueueMicros[queued - _gatewayRxQueueStorage]);
+		LATENCY_MARK(LATENCY_TX_QUEUE);
+		(void)_gatewayRxQueue.popBack();
+		_gatewayRxQueueStats.processed++;
 		if (_msg.getDestination() == GATEWAY_ADDRESS) {
 
 			// Check if sender requests an echo
@@ -61,9 +110,21 @@ inline void gatewayTransportProcess(void)
 				}
 			}
 		} else {
+#if defined(MY_LINUX_OTA_CACHE)
+			otaCacheSnoop(_msg);
+#endif
 #if defined(MY_SENSOR_NETWORK)
 			transportSendRoute(_msg);
 #endif
 		}
+		LATENCY_END(LATENCY_PATH_TX);
+	}
+	return !_gatewayRxQueue.empty();
+}
+
+void gatewayTransportDeferred(void)
+{
+	if (!_gatewayRxQueue.empty()) {
+		_gatewayRxQueueStats.deferred++;
 	}
 }
@@ -85,10 +85,76 @@
 #define GATEWAY_DEBUG(x,...)									//!< debug NULL
 #endif
 
+/**
+ * @brief Inbound message queue statistics
+ */
+typedef struct {
+	uint8_t depth;				//!< Messages currently queued
+	uint8_t maxDepth;			//!< Highest queue depth seen
+	uint32_t received;			//!< Messages queued since start
+	uint32_t processed;			//!< Messages processed since start
+	uint32_t deferred;			//!< Iterations that left messages for the next one
+} gatewayTransportRxQueueStats_t;
+
+#if defined(MY_LINUX_GATEWAY_THREADED)
+/**
+ * @brief Queue statistics of the threaded Linux gateway
+ */
+typedef struct {
+	uint16_t toCoreDepth;			//!< Controller messages waiting for the core thread
+	uint16_t toControllerDepth;		//!< Messages waiting for the controller I/O thread
+	uint32_t toCoreStalls;			//!< Times the I/O thread waited for the core thread
+	uint32_t toControllerDropped;	//!< Messages dropped because the I/O thread fell behind
+} gatewayTransportThreadStats_t;
+
+/**
+ * @brief Get queue statistics of the threaded Linux gateway
+ * @param stats to fill in
+ */
+void gatewayTransportGetThreadStats(gatewayTransportThreadStats_t *stats);
+#endif
+
+#if defined(MY_GATEWAY_LINUX) && !defined(MY_GATEWAY_MQTT_CLIENT) && !defined(MY_GATEWAY_CLIENT_MODE)
+/**
+ * @brief Outbound queue statistics of a controller connection of the Linux ethernet gateway
+ */
+typedef struct {
+	uint32_t queuedBytes;		//!< Bytes waiting to be sent
+	uint32_t queuedMessages;	//!< Writes waiting to be sent
+	uint32_t maxQueuedBytes;	//!< Highest queuedBytes since the client connected
+	uint32_t dropped;			//!< Writes dropped by the slow client policy
+	uint32_t lagMs;				//!< Age of the oldest queued write
+} gatewayTransportClientStats_t;
+
+/**
+ * @brief Get the outbound queue statistics of a controller connection
+ * @param slot of the connection, below MY_GATEWAY_MAX_CLIENTS
+ * @param stats to fill in
+ * @return false if no controller is connected in this slot
+ */
+bool gatewayTransportGetClientStats(const uint8_t slot, gatewayTransportClientStats_t *stats);
+#endif
+
 /**
  * @brief Process gateway-related messages
+ *
+ * Moves all messages available from the controller into the inbound queue
+ * and processes up to budget of them.
+ * @param budget max number of messages to process
+ * @return true if messages are left in the queue
+ */
+bool gatewayTransportProcess(const uint8_t budget = MY_GATEWAY_RX_PROCESS_BUDGET);
+
+/**
+ * @brief Count the loop iteration as deferred if it left controller messages for the next one
+ */
+void gatewayTransportDeferred(void);
+
+/**
+ * @brief Get inbound message queue statistics
+ * @return pointer to statistics
  */
-void gatewayTransportProcess(void);
+const gatewayTransportRxQueueStats_t *gatewayTransportGetRxQueueStats(void);
 
 /**
  * @brief Initialize gateway transport driver
@@ -112,7 +112,13 @@ static inputBuffer inputString;
 #else
 static EthernetClient client = EthernetClient();
 #endif /* End of MY_USE_UDP */
-#elif defined(MY_GATEWAY_ESP8266) || defined(MY_GATEWAY_ESP32) || defined(MY_GATEWAY_LINUX)
+#elif defined(MY_GATEWAY_LINUX)
+// Indexed by server slot, partial lines stay in the client's receive buffer
+static EthernetClient clients[MY_GATEWAY_MAX_CLIENTS];
+static inputBuffer inputString;
+static int _ethernetReadSlot = -1;
+static uint8_t _ethernetReadLines = 0;
+#elif defined(MY_GATEWAY_ESP8266) || defined(MY_GATEWAY_ESP32)
 static EthernetClient clients[MY_GATEWAY_MAX_CLIENTS];
 static bool clientsConnected[MY_GATEWAY_MAX_CLIENTS];
 static inputBuffer inputString[MY_GATEWAY_MAX_CLIENTS];
@@ -223,6 +229,14 @@ bool gatewayTransportInit(void)
 	}
 #endif /* End of MY_USE_UDP */
 #else /* Else part of MY_GATEWAY_CLIENT_MODE */
+#if defined(MY_GATEWAY_LINUX)
+	// Slow controllers are queued for, never waited for
+#if defined(MY_LINUX_GATEWAY_SLOW_CLIENT_DISCONNECT)
+	_ethernetServer.setTxQueue(MY_LINUX_GATEWAY_TX_QUEUE_SIZE, ETHERNETSERVER_SLOW_CLIENT_DISCONNECT);
+#else
+	_ethernetServer.setTxQueue(MY_LINUX_GATEWAY_TX_QUEUE_SIZE, ETHERNETSERVER_SLOW_CLIENT_DROP_OLDEST);
+#endif
+#endif
 #if defined(MY_GATEWAY_LINUX) && defined(MY_IP_ADDRESS)
 	_ethernetServer.begin(_ethernetGatewayIP);
 #else
@@ -235,11 +249,29 @@ bool gatewayTransportInit(void)
 	return true;
 }
 
+#if defined(MY_GATEWAY_LINUX) && !defined(MY_GATEWAY_CLIENT_MODE)
+bool gatewayTransportGetClientStats(const uint8_t slot, gatewayTransportClientStats_t *stats)
+{
+	EthernetServerClientStats client;
+	if (!_ethernetServer.clientStats(slot, client)) {
+		return false;
+	}
+	stats->queuedBytes = client.queuedBytes;
+	stats->queuedMessages = client.queuedMessages;
+	stats->maxQueuedBytes = client.maxQueuedBytes;
+	stats->dropped = client.dropped;
+	stats->lagMs = client.lagMs;
+	return true;
+}
+#endif
+
 // cppcheck-suppress constParameter
 bool gatewayTransportSend(MyMessage &message)
 {
 	int nbytes = 0;
-	char *_ethernetMessage = protocolMyMessage2Serial(message);
+	char _ethernetMessage[MY_GATEWAY_MAX_SEND_LENGTH];
+	(void)protocolFormatSerial(message, _ethernetMessage, sizeof(_ethernetMessage));
+	LATENCY_MARK(LATENCY_RX_GW_FORMAT);
 
 	setIndication(INDICATION_GW_TX);
 
@@ -289,13 +321,33 @@ bool gatewayTransportSend(MyMessage &message)
 #endif /* End of MY_GATEWAY_ESPxx */
 #endif /* End of MY_GATEWAY_CLIENT_MODE */
 	_w5100_spi_en(false);
+	LATENCY_MARK(LATENCY_RX_GW_WRITE);
 	return (nbytes > 0);
 }
 
 #if defined(MY_USE_UDP)
 // Nothing to do here
 #else
-#if (defined(MY_GATEWAY_ESP8266) || defined(MY_GATEWAY_ESP32) || defined(MY_GATEWAY_LINUX)) && !defined(MY_GATEWAY_CLIENT_MODE)
+#if defined(MY_GATEWAY_LINUX) && !defined(MY_GATEWAY_CLIENT_MODE)
+bool _readFromClient(uint16_t i)
+{
+	// Split complete lines straight out of the client's receive buffer
+	int len;
+	while ((len = clients[i].readLine(inputString.string,
+	                                  MY_GATEWAY_MAX_RECEIVE_LENGTH)) != ETHERNETCLIENT_LINE_NONE) {
+		if (len == ETHERNETCLIENT_LINE_TOO_LONG) {
+			// Incoming message too long, thrown away. The lines after it are fine
+			GATEWAY_DEBUG(PSTR("!GWT:RFC:C=%" PRIu16 ",MSG TOO LONG\n"), i);
+			continue;
+		}
+		GATEWAY_DEBUG(PSTR("GWT:RFC:C=%" PRIu16 ",MSG=%s\n"), i, inputString.string);
+		if (protocolSerial2MyMessage(_ethernetMsg, inputString.string)) {
+			return true;
+		}
+	}
+	return false;
+}
+#elif (defined(MY_GATEWAY_ESP8266) || defined(MY_GATEWAY_ESP32)) && !defined(MY_GATEWAY_CLIENT_MODE)
 bool _readFromClient(uint8_t i)
 {
 	while (clients[i].connected() && clients[i].available()) {
@@ -324,9 +376,25 @@ bool _readFromClient(uint8_t i)
 	}
 	return false;
 }
-#else /* Else part of MY_GATEWAY_ESP8266 || MY_GATEWAY_LINUX || !MY_GATEWAY_CLIENT_MODE */
+#else /* Else part of MY_GATEWAY_LINUX / MY_GATEWAY_ESPxx && !MY_GATEWAY_CLIENT_MODE */
 bool _readFromClient(void)
 {
+#if defined(MY_GATEWAY_LINUX)
+	// Split complete lines straight out of the client's receive buffer
+	int len;
+	while ((len = client.readLine(inputString.string,
+	                              MY_GATEWAY_MAX_RECEIVE_LENGTH)) != ETHERNETCLIENT_LINE_NONE) {
+		if (len == ETHERNETCLIENT_LINE_TOO_LONG) {
+			// Incoming message too long. Throw away
+			GATEWAY_DEBUG(PSTR("!GWT:RFC:MSG TOO LONG\n"));
+			break;
+		}
+		GATEWAY_DEBUG(PSTR("GWT:RFC:MSG=%s\n"), inputString.string);
+		if (protocolSerial2MyMessage(_ethernetMsg, inputString.string)) {
+			return true;
+		}
+	}
+#else
 	while (client.connected() && client.available()) {
 		const char inChar = client.read();
 		if (inputString.idx < MY_GATEWAY_MAX_RECEIVE_LENGTH - 1) {
@@ -352,9 +420,10 @@ bool _readFromClient(void)
 			break;
 		}
 	}
+#endif /* End of MY_GATEWAY_LINUX */
 	return false;
 }
-#endif /* End of MY_GATEWAY_ESP8266 || MY_GATEWAY_LINUX || !MY_GATEWAY_CLIENT_MODE */
+#endif /* End of MY_GATEWAY_LINUX / MY_GATEWAY_ESPxx && !MY_GATEWAY_CLIENT_MODE */
 #endif /* End of MY_USE_UDP */
 
 bool gatewayTransportAvailable(void)
@@ -406,7 +475,47 @@ bool gatewayTransportAvailable(void)
 	}
 #endif /* End of MY_USE_UDP */
 #else /* Else part of MY_GATEWAY_CLIENT_MODE */
-#if defined(MY_GATEWAY_ESP8266) || defined(MY_GATEWAY_ESP32) || defined(MY_GATEWAY_LINUX)
+#if defined(MY_GATEWAY_LINUX)
+	// The server reports new connections and clients with pending input or a hang-up,
+	// idle clients are never looked at
+	uint16_t slot;
+	while (_ethernetServer.hasClient()) {
+		EthernetClient newClient = _ethernetServer.available(slot);
+		clients[slot] = newClient;
+		GATEWAY_DEBUG(PSTR("GWT:TSA:C=%" PRIu16 ",CONNECTED\n"), slot);
+		gatewayTransportSend(buildGw(_msgTmp, I_GATEWAY_READY).set(MSG_GW_STARTUP_COMPLETE));
+		// Send presentation of locally attached sensors (and node if applicable)
+		presentNode();
+	}
+	// A client that delivered a message may have more lines buffered, continue with it
+	// for up to MY_GATEWAY_CLIENT_LINE_BUDGET lines, then let the other clients in
+	int ready;
+	while ((ready = _ethernetReadSlot != -1 ? _ethernetReadSlot : _ethernetServer.readyClient()) != -1) {
+		if (_readFromClient(ready)) {
+			if (++_ethernetReadLines < MY_GATEWAY_CLIENT_LINE_BUDGET) {
+				_ethernetReadSlot = ready;
+			} else {
+				_ethernetReadSlot = -1;
+				_ethernetReadLines = 0;
+				if (clients[ready].hasLine()) {
+					// epoll does not report lines that are already buffered
+					_ethernetServer.requeueClient(ready);
+				}
+			}
+			setIndication(INDICATION_GW_RX);
+			_w5100_spi_en(false);
+			return true;
+		}
+		_ethernetReadSlot = -1;
+		_ethernetReadLines = 0;
+		if (!clients[ready].connected()) {
+			GATEWAY_DEBUG(PSTR("GWT:TSA:C=%" PRIu16 ",DISCONNECTED\n"), (uint16_t)ready);
+			// The peer is gone, no need to wait for a graceful shutdown
+			clients[ready].close();
+			_ethernetServer.release(ready);
+		}
+	}
+#elif defined(MY_GATEWAY_ESP8266) || defined(MY_GATEWAY_ESP32)
 	// ESP8266/ESP32: Go over list of clients and stop any that are no longer connected.
 	// If the server has a new client connection it will be assigned to a free slot.
 	bool allSlotsOccupied = true;
@@ -444,7 +553,7 @@ bool gatewayTransportAvailable(void)
 			return true;
 		}
 	}
-#else /* Else part of MY_GATEWAY_ESP8266 || MY_GATEWAY_LINUX */
+#else /* Else part of MY_GATEWAY_LINUX / MY_GATEWAY_ESPxx */
 	// W5100/ENC module does not have hasClient-method. We can only serve one client at the time.
 	EthernetClient newclient = _ethernetServer.available();
 	// if a new client connects make sure to dispose any previous existing sockets
@@ -471,7 +580,7 @@ bool gatewayTransportAvailable(void)
 			}
 		}
 	}
-#endif /* End of MY_GATEWAY_ESP8266 || MY_GATEWAY_LINUX */
+#endif /* End of MY_GATEWAY_LINUX / MY_GATEWAY_ESPxx */
 #endif /* End of MY_GATEWAY_CLIENT_MODE */
 	_w5100_spi_en(false);
 	return false;
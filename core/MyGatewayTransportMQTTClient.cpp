@@ -124,7 +124,10 @@ bool gatewayTransportSend(MyMessage &message)
 		return false;
 	}
 	setIndication(INDICATION_GW_TX);
-	char *topic = protocolMyMessage2MQTT(MY_MQTT_PUBLISH_TOPIC_PREFIX, message);
+	char topic[MY_GATEWAY_MAX_SEND_LENGTH];
+	char payload[MAX_PAYLOAD_SIZE * 2 + 1];
+	(void)protocolFormatMQTTTopic(MY_MQTT_PUBLISH_TOPIC_PREFIX, message, topic, sizeof(topic));
+	LATENCY_MARK(LATENCY_RX_GW_FORMAT);
 	GATEWAY_DEBUG(PSTR("GWT:TPS:TOPIC=%s,MSG SENT\n"), topic);
 #if defined(MY_MQTT_CLIENT_PUBLISH_RETAIN)
 	const bool retain = message.getCommand() == C_SET ||
@@ -132,7 +135,10 @@ bool gatewayTransportSend(MyMessage &message)
 #else
 	const bool retain = false;
 #endif /* End of MY_MQTT_CLIENT_PUBLISH_RETAIN */
-	return _MQTT_client.publish(topic, message.getString(_convBuffer), retain);
+	(void)protocolFormatPayload(message, payload, sizeof(payload));
+	const bool result = _MQTT_client.publish(topic, payload, retain);
+	LATENCY_MARK(LATENCY_RX_GW_WRITE);
+	return result;
 }
 
 void incomingMQTT(char *topic, uint8_t *payload, unsigned int length)
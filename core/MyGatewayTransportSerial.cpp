@@ -34,7 +34,11 @@ MyMessage _serialMsg;
 bool gatewayTransportSend(MyMessage &message)
 {
 	setIndication(INDICATION_GW_TX);
-	MY_SERIALDEVICE.print(protocolMyMessage2Serial(message));
+	char line[MY_GATEWAY_MAX_SEND_LENGTH];
+	(void)protocolFormatSerial(message, line, sizeof(line));
+	LATENCY_MARK(LATENCY_RX_GW_FORMAT);
+	MY_SERIALDEVICE.print(line);
+	LATENCY_MARK(LATENCY_RX_GW_WRITE);
 	// Serial print is always successful
 	return true;
 }
@@ -49,6 +53,19 @@ bool gatewayTransportInit(void)
 
 bool gatewayTransportAvailable(void)
 {
+#if defined(__linux__) && defined(MY_LINUX_SERIAL_PORT)
+	// Split complete lines straight out of the serial port receive buffer
+	int len;
+	while ((len = MY_SERIALDEVICE.readLine(_serialInputString,
+	                                       MY_GATEWAY_MAX_RECEIVE_LENGTH)) != SERIALPORT_LINE_NONE) {
+		// Incoming message too long is thrown away
+		if (len != SERIALPORT_LINE_TOO_LONG &&
+		        protocolSerial2MyMessage(_serialMsg, _serialInputString)) {
+			setIndication(INDICATION_GW_RX);
+			return true;
+		}
+	}
+#else
 	while (MY_SERIALDEVICE.available()) {
 		// get the new byte:
 		const char inChar = (char)MY_SERIALDEVICE.read();
@@ -73,6 +90,7 @@ bool gatewayTransportAvailable(void)
 			_serialInputPos = 0;
 		}
 	}
+#endif
 	return false;
 }
 
@@ -0,0 +1,240 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+// Threaded Linux gateway. The controller transport runs on a thread of its own and
+// exchanges messages with the core thread, which owns the radio, through two
+// lock-free SPSC rings. MySensors.h includes this file instead of the transport set
+// in MY_LINUX_GATEWAY_THREADED_TRANSPORT, which is compiled below with its public
+// functions renamed to gatewayTransportIo*().
+
+#if !defined(__linux__)
+#error MY_LINUX_GATEWAY_THREADED is only available on Linux
+#endif
+
+#include <atomic>
+#include <pthread.h>
+#include <semaphore.h>
+#include "SpscRing.h"
+
+#if MY_LINUX_GATEWAY_QUEUE_SIZE <= MY_GATEWAY_RX_QUEUE_SIZE
+#error MY_LINUX_GATEWAY_QUEUE_SIZE must be larger than MY_GATEWAY_RX_QUEUE_SIZE
+#endif
+
+// The I/O thread only has sockets to wait for, wake up now and then for reconnects
+#define GATEWAY_IO_IDLE_TIMEOUT_MS (1000ul)
+
+static void gatewayTransportIoPresentNode(void);
+static MyMessage _gatewayIoMsgTmp;
+
+// Controller side, runs on the I/O thread
+#define gatewayTransportInit gatewayTransportIoInit
+#define gatewayTransportSend gatewayTransportIoSend
+#define gatewayTransportAvailable gatewayTransportIoAvailable
+#define gatewayTransportReceive gatewayTransportIoReceive
+#define gatewayTransportGetClientStats gatewayTransportIoGetClientStats
+// Core state must only be touched by the core thread
+#define presentNode gatewayTransportIoPresentNode
+#define setIndication(x) (void)(x)
+#define _msgTmp _gatewayIoMsgTmp
+#pragma push_macro("LATENCY_MARK")
+#undef LATENCY_MARK
+#define LATENCY_MARK(stage)
+
+#include MY_LINUX_GATEWAY_THREADED_TRANSPORT
+
+#undef gatewayTransportInit
+#undef gatewayTransportSend
+#undef gatewayTransportAvailable
+#undef gatewayTransportReceive
+#undef gatewayTransportGetClientStats
+#undef presentNode
+#undef setIndication
+#undef _msgTmp
+#undef LATENCY_MARK
+#pragma pop_macro("LATENCY_MARK")
+
+static SpscRing<MyMessage, MY_LINUX_GATEWAY_QUEUE_SIZE> _gatewayToCore;
+static SpscRing<MyMessage, MY_LINUX_GATEWAY_QUEUE_SIZE> _gatewayToController;
+static std::atomic<uint32_t> _gatewayToCoreStalls(0);
+static std::atomic<uint32_t> _gatewayToControllerDropped(0);
+static std::atomic<bool> _gatewayIoPresentRequest(false);
+static pthread_t _gatewayIoThread;
+static sem_t _gatewayIoReady;
+static int _gatewayIoLoop = -1;
+static bool _gatewayIoInitResult = false;
+static MyMessage _gatewayCoreMsg;
+static bool _gatewayCoreMsgAvailable = false;
+
+#if defined(MY_GATEWAY_LINUX) && !defined(MY_GATEWAY_MQTT_CLIENT) && !defined(MY_GATEWAY_CLIENT_MODE)
+// The client queues belong to the I/O thread, it publishes a copy of their statistics
+static pthread_mutex_t _gatewayIoClientStatsMutex = PTHREAD_MUTEX_INITIALIZER;
+static gatewayTransportClientStats_t _gatewayIoClientStats[MY_GATEWAY_MAX_CLIENTS];
+static bool _gatewayIoClientConnected[MY_GATEWAY_MAX_CLIENTS];
+
+static void gatewayTransportIoUpdateClientStats(void)
+{
+	gatewayTransportClientStats_t stats[MY_GATEWAY_MAX_CLIENTS];
+	bool connected[MY_GATEWAY_MAX_CLIENTS];
+	for (uint8_t slot = 0; slot < MY_GATEWAY_MAX_CLIENTS; slot++) {
+		connected[slot] = gatewayTransportIoGetClientStats(slot, &stats[slot]);
+	}
+	pthread_mutex_lock(&_gatewayIoClientStatsMutex);
+	(void)memcpy(_gatewayIoClientStats, stats, sizeof(stats));
+	(void)memcpy(_gatewayIoClientConnected, connected, sizeof(connected));
+	pthread_mutex_unlock(&_gatewayIoClientStatsMutex);
+}
+#endif
+
+static void gatewayTransportIoPresentNode(void)
+{
+	// Presentation goes through the core, leave it to the core thread
+	_gatewayIoPresentRequest = true;
+	eventLoopWakeup();
+}
+
+static void gatewayTransportIoFlush(void)
+{
+	MyMessage message;
+	bool sent = false;
+	while (_gatewayToController.pop(message)) {
+		(void)gatewayTransportIoSend(message);
+		sent = true;
+	}
+	if (sent && _gatewayToCore.size() > 0) {
+		// The core thread may be holding back requests, see gatewayTransportAvailable()
+		eventLoopWakeup();
+	}
+}
+
+static void *gatewayTransportIoMain(void *arg)
+{
+	(void)arg;
+	eventLoopBlockSignals();
+	_gatewayIoLoop = eventLoopThreadInit();
+	_gatewayIoInitResult = gatewayTransportIoInit();
+	(void)sem_post(&_gatewayIoReady);
+
+	while (true) {
+		// Controller to core, stop reading while the core thread is behind
+		while (_gatewayToCore.size() < MY_LINUX_GATEWAY_QUEUE_SIZE && gatewayTransportIoAvailable()) {
+			// Only an empty ring may have let the core thread go idle
+			if (_gatewayToCore.push(gatewayTransportIoReceive()) && _gatewayToCore.size() == 1) {
+				eventLoopWakeup();
+			}
+			// Replies must not pile up behind a long burst of requests
+			gatewayTransportIoFlush();
+		}
+		gatewayTransportIoFlush();
+#if defined(MY_GATEWAY_LINUX) && !defined(MY_GATEWAY_MQTT_CLIENT) && !defined(MY_GATEWAY_CLIENT_MODE)
+		gatewayTransportIoUpdateClientStats();
+#endif
+
+		if (_gatewayToCore.size() == MY_LINUX_GATEWAY_QUEUE_SIZE) {
+			// Sockets stay readable, sleep until the core thread makes room or sends
+			_gatewayToCoreStalls++;
+			(void)eventLoopWaitWakeup(GATEWAY_IO_IDLE_TIMEOUT_MS);
+		} else {
+			(void)eventLoopWait(GATEWAY_IO_IDLE_TIMEOUT_MS);
+		}
+	}
+
+	return NULL;
+}
+
+bool gatewayTransportInit(void)
+{
+	if (sem_init(&_gatewayIoReady, 0, 0) != 0) {
+		logError("sem_init: %s\n", strerror(errno));
+		return false;
+	}
+	if (pthread_create(&_gatewayIoThread, NULL, gatewayTransportIoMain, NULL) != 0) {
+		logError("Unable to start the controller I/O thread\n");
+		return false;
+	}
+	while (sem_wait(&_gatewayIoReady) == -1 && errno == EINTR) {
+	}
+	GATEWAY_DEBUG(PSTR("GWT:TIN:THREADED,QUEUE=%" PRIu16 "\n"), (uint16_t)MY_LINUX_GATEWAY_QUEUE_SIZE);
+	return _gatewayIoInitResult;
+}
+
+bool gatewayTransportSend(MyMessage &message)
+{
+	setIndication(INDICATION_GW_TX);
+	if (!_gatewayToController.push(message)) {
+		// Never block the radio on a slow controller
+		_gatewayToControllerDropped++;
+		GATEWAY_DEBUG(PSTR("!GWT:TPS:QUEUE FULL\n"));
+		return false;
+	}
+	eventLoopWakeupLoop(_gatewayIoLoop);
+	return true;
+}
+
+bool gatewayTransportAvailable(void)
+{
+	if (_gatewayIoPresentRequest.exchange(false)) {
+		presentNode();
+	}
+	// Leave room for the replies of a full rx queue, controller requests wait in the ring
+	// until the I/O thread has caught up
+	if (!_gatewayCoreMsgAvailable &&
+	        _gatewayToController.size() + MY_GATEWAY_RX_QUEUE_SIZE < MY_LINUX_GATEWAY_QUEUE_SIZE &&
+	        _gatewayToCore.pop(_gatewayCoreMsg)) {
+		setIndication(INDICATION_GW_RX);
+		_gatewayCoreMsgAvailable = true;
+		const size_t queued = _gatewayToCore.size();
+		if (queued == MY_LINUX_GATEWAY_QUEUE_SIZE - 1) {
+			// The I/O thread may be waiting for room
+			eventLoopWakeupLoop(_gatewayIoLoop);
+		}
+		if (queued > 0) {
+			// The wake-up is consumed, keep the core loop going until the ring is empty
+			eventLoopPending();
+		}
+	}
+	return _gatewayCoreMsgAvailable;
+}
+
+MyMessage& gatewayTransportReceive(void)
+{
+	_gatewayCoreMsgAvailable = false;
+	return _gatewayCoreMsg;
+}
+
+void gatewayTransportGetThreadStats(gatewayTransportThreadStats_t *stats)
+{
+	stats->toCoreDepth = _gatewayToCore.size();
+	stats->toControllerDepth = _gatewayToController.size();
+	stats->toCoreStalls = _gatewayToCoreStalls;
+	stats->toControllerDropped = _gatewayToControllerDropped;
+}
+
+#if defined(MY_GATEWAY_LINUX) && !defined(MY_GATEWAY_MQTT_CLIENT) && !defined(MY_GATEWAY_CLIENT_MODE)
+bool gatewayTransportGetClientStats(const uint8_t slot, gatewayTransportClientStats_t *stats)
+{
+	if (slot >= MY_GATEWAY_MAX_CLIENTS) {
+		return false;
+	}
+	pthread_mutex_lock(&_gatewayIoClientStatsMutex);
+	const bool connected = _gatewayIoClientConnected[slot];
+	*stats = _gatewayIoClientStats[slot];
+	pthread_mutex_unlock(&_gatewayIoClientStatsMutex);
+	return connected;
+}
+#endif
@@ -0,0 +1,243 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyLatency.h"
+
+#if defined(__linux__)
+#include <csignal>
+#define LATENCY_BUCKETS			(24u)	// 1us .. 8s
+#define LATENCY_SHIFT			(0u)
+#define LATENCY_COUNT_MAX		UINT32_MAX
+typedef uint32_t latencyCount_t;
+#else
+#define LATENCY_BUCKETS			(16u)	// 16us .. 0.5s
+#define LATENCY_SHIFT			(4u)
+#define LATENCY_COUNT_MAX		UINT16_MAX
+typedef uint16_t latencyCount_t;
+#endif
+
+#define LATENCY_NESTING			(4u)	// nested paths that restore the outer stage
+
+#if defined(ARDUINO_ARCH_AVR)
+#define LATENCY_NAME_FORMAT		"%S"	// stage names are read from PROGMEM
+#else
+#define LATENCY_NAME_FORMAT		"%s"
+#endif
+
+#if defined(MY_RADIO_RF24)
+#define LATENCY_RADIO_NAME		"RF24"
+#elif defined(MY_RADIO_NRF5_ESB)
+#define LATENCY_RADIO_NAME		"NRF5_ESB"
+#elif defined(MY_RADIO_RFM69)
+#define LATENCY_RADIO_NAME		"RFM69"
+#elif defined(MY_RADIO_RFM95)
+#define LATENCY_RADIO_NAME		"RFM95"
+#elif defined(MY_RS485)
+#define LATENCY_RADIO_NAME		"RS485"
+#elif defined(MY_PJON)
+#define LATENCY_RADIO_NAME		"PJON"
+#else
+#define LATENCY_RADIO_NAME		"NONE"
+#endif
+
+#if defined(MY_GATEWAY_SERIAL)
+#define LATENCY_GATEWAY_NAME	"SERIAL"
+#elif defined(MY_GATEWAY_MQTT_CLIENT)
+#define LATENCY_GATEWAY_NAME	"MQTT"
+#elif defined(MY_GATEWAY_FEATURE)
+#define LATENCY_GATEWAY_NAME	"ETHERNET"
+#else
+#define LATENCY_GATEWAY_NAME	"NONE"
+#endif
+
+typedef struct {
+	latencyCount_t counts[LATENCY_BUCKETS];	// bucket n: [2^(n-1), 2^n) << LATENCY_SHIFT
+	uint32_t max;
+} latencyHistogram_t;
+
+typedef struct {
+	uint32_t start;
+	uint32_t last;
+	uint32_t outerLast[LATENCY_NESTING];
+	uint8_t depth;
+	bool marked;
+} latencyPathState_t;
+
+static latencyHistogram_t _latencyHistograms[LATENCY_STAGE_COUNT];
+static latencyPathState_t _latencyPaths[LATENCY_PATH_COUNT];
+static const char _latencyStageNames[LATENCY_STAGE_COUNT][7] PROGMEM = {
+	"RX:HAL", "RX:VER", "RX:RTE", "RX:GWF", "RX:GWW", "RX:TOT",
+	"TX:PRS", "TX:QUE", "TX:RTE", "TX:SGN", "TX:HAL", "TX:TOT"
+};
+
+static uint8_t latencyBucket(uint32_t durationUS)
+{
+	durationUS >>= LATENCY_SHIFT;
+	uint8_t bucket = 0;
+	while (durationUS != 0 && bucket < LATENCY_BUCKETS - 1) {
+		durationUS >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+static uint32_t latencyPercentile(const latencyHistogram_t &histogram, const uint32_t count,
+                                  const uint8_t percent)
+{
+	// rank of the percentile, 1..count
+	const uint32_t rank = count / 100u * percent + (count % 100u * percent + 99u) / 100u;
+	uint32_t below = 0;
+	for (uint8_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+		const uint32_t inBucket = histogram.counts[bucket];
+		if (below + inBucket >= rank) {
+			const uint32_t low = bucket == 0 ? 0 : (uint32_t)1 << (bucket - 1 + LATENCY_SHIFT);
+			const uint32_t high = bucket == LATENCY_BUCKETS - 1 ? histogram.max :
+			                      min(histogram.max, (uint32_t)1 << (bucket + LATENCY_SHIFT));
+			// interpolate linearly within the bucket
+			return low + (uint32_t)((uint64_t)(high - low) * (rank - below) / inBucket);
+		}
+		below += inBucket;
+	}
+	return histogram.max;
+}
+
+void latencyBegin(const latencyPath_t path, const uint32_t startUS)
+{
+	latencyPathState_t &state = _latencyPaths[path];
+	if (state.depth == 0) {
+		state.start = startUS;
+		state.last = startUS;
+		state.marked = false;
+	} else if (state.depth <= LATENCY_NESTING) {
+		// a message sent or received within a stage, e.g. a nonce request, counts to that stage
+		state.outerLast[state.depth - 1] = state.last;
+	}
+	state.depth++;
+}
+
+void latencyMark(const latencyStage_t stage)
+{
+	latencyPathState_t &state = _latencyPaths[stage <= LATENCY_RX_TOTAL ? LATENCY_PATH_RX :
+	                            LATENCY_PATH_TX];
+	if (state.depth == 0) {
+		return;
+	}
+	const uint32_t now = hwMicros();
+	latencyObserve(stage, now - state.last);
+	state.last = now;
+	state.marked = true;
+}
+
+void latencyEnd(const latencyPath_t path)
+{
+	latencyPathState_t &state = _latencyPaths[path];
+	if (state.depth == 0) {
+		return;
+	}
+	state.depth--;
+	if (state.depth != 0) {
+		if (state.depth <= LATENCY_NESTING) {
+			state.last = state.outerLast[state.depth - 1];
+		}
+		return;
+	}
+	if (state.marked) {
+		latencyObserve(path == LATENCY_PATH_RX ? LATENCY_RX_TOTAL : LATENCY_TX_TOTAL,
+		               hwMicros() - state.start);
+	}
+}
+
+void latencyObserve(const latencyStage_t stage, const uint32_t durationUS)
+{
+	latencyHistogram_t &histogram = _latencyHistograms[stage];
+	const uint8_t bucket = latencyBucket(durationUS);
+	if (histogram.counts[bucket] == LATENCY_COUNT_MAX) {
+		// halve all buckets, this keeps the distribution
+		for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+			histogram.counts[i] >>= 1;
+		}
+	}
+	histogram.counts[bucket]++;
+	if (durationUS > histogram.max) {
+		histogram.max = durationUS;
+	}
+}
+
+bool latencyGetReport(const latencyStage_t stage, latencyReport_t &report)
+{
+	const latencyHistogram_t &histogram = _latencyHistograms[stage];
+	report.count = 0;
+	for (uint8_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+		report.count += histogram.counts[bucket];
+	}
+	if (report.count == 0) {
+		return false;
+	}
+	report.p50 = latencyPercentile(histogram, report.count, 50);
+	report.p90 = latencyPercentile(histogram, report.count, 90);
+	report.p99 = latencyPercentile(histogram, report.count, 99);
+	report.max = histogram.max;
+	return true;
+}
+
+const char *latencyStageName(const latencyStage_t stage)
+{
+	return _latencyStageNames[stage];
+}
+
+void latencyPrint(void)
+{
+#if defined(__linux__)
+	logNotice("LAT:RADIO=" LATENCY_RADIO_NAME ",GW=" LATENCY_GATEWAY_NAME "\n");
+#else
+	DEBUG_OUTPUT(PSTR("LAT:RADIO=" LATENCY_RADIO_NAME ",GW=" LATENCY_GATEWAY_NAME "\n"));
+#endif
+	for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+		latencyReport_t report;
+		if (!latencyGetReport(static_cast<latencyStage_t>(stage), report)) {
+			continue;
+		}
+#if defined(__linux__)
+		logNotice("LAT:%s,N=%" PRIu32 ",P50=%" PRIu32 ",P90=%" PRIu32 ",P99=%" PRIu32 ",MAX=%" PRIu32 "\n",
+		          _latencyStageNames[stage], report.count, report.p50, report.p90, report.p99, report.max);
+#else
+		DEBUG_OUTPUT(PSTR("LAT:" LATENCY_NAME_FORMAT ",N=%" PRIu32 ",P50=%" PRIu32 ",P90=%" PRIu32 ",P99=%"
+		                  PRIu32 ",MAX=%" PRIu32 "\n"),
+		             _latencyStageNames[stage], report.count, report.p50, report.p90, report.p99, report.max);
+#endif
+	}
+}
+
+#if defined(__linux__)
+static volatile sig_atomic_t _latencyPrintRequested = 0;
+
+void latencyRequestPrint(void)
+{
+	_latencyPrintRequested = 1;
+	eventLoopWakeup();
+}
+
+void latencyProcess(void)
+{
+	if (_latencyPrintRequested) {
+		_latencyPrintRequested = 0;
+		latencyPrint();
+	}
+}
+#endif
@@ -0,0 +1,166 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file MyLatency.h
+ *
+ * @brief API declaration for MyLatency
+ * @defgroup MyLatencygrp MyLatency
+ * @ingroup internals
+ * @{
+ *
+ * @brief Message path latency histograms, enabled by MY_DEBUG_LATENCY.
+ *
+ * A message is timed with hwMicros() from the start of its path to the end. Each
+ * @ref LATENCY_MARK observes the time since the previous mark in the histogram of its stage,
+ * @ref LATENCY_END observes the total time. Begin and end pairs nest, only the outermost pair
+ * starts and ends the path. A nested message, e.g. a nonce request while signing, is timed as
+ * well and counts to the stage it was sent or received in. Marks outside of a path are ignored.
+ *
+ * | Path | Begin                         | Stages
+ * |------|-------------------------------|------------------------------------------------------
+ * | RX   | before transportHALReceive()  | HAL receive, signature verify, routing, gateway message format, gateway write
+ * | TX   | controller message read, or transportSendRoute() | controller message parse, gateway queue, routing, signing, HAL send
+ *
+ * Histogram buckets are powers of two, percentiles are interpolated within their bucket.
+ */
+#ifndef MyLatency_h
+#define MyLatency_h
+
+#if defined(MY_DEBUG_LATENCY)
+
+/**
+ * @brief Message paths
+ */
+typedef enum {
+	LATENCY_PATH_RX,				//!< Radio to gateway transport, or to the node
+	LATENCY_PATH_TX,				//!< Gateway transport, or the node, to radio
+	LATENCY_PATH_COUNT				//!< Number of paths
+} latencyPath_t;
+
+/**
+ * @brief Timed stages, the total of each path is last
+ */
+typedef enum {
+	LATENCY_RX_HAL,					//!< transportHALReceive()
+	LATENCY_RX_VERIFY,				//!< signature verification
+	LATENCY_RX_ROUTE,				//!< processing up to the hand over to the controller
+	LATENCY_RX_GW_FORMAT,			//!< gateway protocol formatting
+	LATENCY_RX_GW_WRITE,			//!< gateway transport write
+	LATENCY_RX_TOTAL,				//!< total of the RX path
+	LATENCY_TX_PARSE,				//!< controller message read and parse
+	LATENCY_TX_QUEUE,				//!< time in the gateway receive queue
+	LATENCY_TX_ROUTE,				//!< processing up to transportSendWrite()
+	LATENCY_TX_SIGN,				//!< signing
+	LATENCY_TX_HAL,					//!< transportHALSend(), including radio retries
+	LATENCY_TX_TOTAL,				//!< total of the TX path
+	LATENCY_STAGE_COUNT				//!< Number of stages
+} latencyStage_t;
+
+/**
+ * @brief Percentiles of a stage, in microseconds
+ */
+typedef struct {
+	uint32_t count;					//!< Observations, reduced by half whenever a bucket saturates
+	uint32_t p50;					//!< Median
+	uint32_t p90;					//!< 90th percentile
+	uint32_t p99;					//!< 99th percentile
+	uint32_t max;					//!< Maximum
+} latencyReport_t;
+
+/**
+ * @brief Start a path, unless it is already active
+ *
+ * @param path Path
+ * @param startUS hwMicros() when the message entered the path
+ */
+void latencyBegin(const latencyPath_t path, const uint32_t startUS);
+
+/**
+ * @brief Observe the time since the previous mark of an active path
+ *
+ * @param stage Stage that ends now
+ */
+void latencyMark(const latencyStage_t stage);
+
+/**
+ * @brief End a path, the outermost end observes the total time if any stage was marked
+ *
+ * @param path Path
+ */
+void latencyEnd(const latencyPath_t path);
+
+/**
+ * @brief Add an observation to a stage
+ *
+ * @param stage Stage
+ * @param durationUS Duration in microseconds
+ */
+void latencyObserve(const latencyStage_t stage, const uint32_t durationUS);
+
+/**
+ * @brief Get the percentiles of a stage
+ *
+ * @param stage Stage
+ * @param report Percentiles
+ * @return true if the stage has observations
+ */
+bool latencyGetReport(const latencyStage_t stage, latencyReport_t &report);
+
+/**
+ * @brief Short name of a stage, e.g. "RX:HAL"
+ *
+ * @param stage Stage
+ * @return name, in PROGMEM on AVR
+ */
+const char *latencyStageName(const latencyStage_t stage);
+
+/**
+ * @brief Print the percentiles of all stages
+ *
+ * On Linux they are written to the log, otherwise to the debug output.
+ */
+void latencyPrint(void);
+
+#if defined(__linux__)
+/**
+ * @brief Request latencyPrint() from the main loop, can be called from a signal handler
+ */
+void latencyRequestPrint(void);
+
+/**
+ * @brief Print the percentiles if requested, called from the main loop
+ */
+void latencyProcess(void);
+#endif
+
+#define LATENCY_BEGIN(path) latencyBegin(path, hwMicros())	//!< Start a path now
+#define LATENCY_BEGIN_AT(path, startUS) latencyBegin(path, startUS)	//!< Start a path at startUS
+#define LATENCY_MARK(stage) latencyMark(stage)	//!< End a stage
+#define LATENCY_END(path) latencyEnd(path)	//!< End a path
+#else
+#define LATENCY_BEGIN(path)	//!< LATENCY_BEGIN NULL
+#define LATENCY_BEGIN_AT(path, startUS)	//!< LATENCY_BEGIN_AT NULL
+#define LATENCY_MARK(stage)	//!< LATENCY_MARK NULL
+#define LATENCY_END(path)	//!< LATENCY_END NULL
+#endif
+
+#endif /* MyLatency_h */
+
+/** @}*/
@@ -0,0 +1,356 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyMetrics.h"
+
+#include <pthread.h>
+
+typedef struct {
+	uint32_t rx;			// Messages received from this node
+	uint32_t tx;			// Transmissions to this node as next hop
+	uint32_t txFailed;		// Transmissions not acknowledged
+	uint32_t verifyFailed;	// Messages failing signature verification
+	metricsHistogram_t rssi;	// Reception RSSI from this node as last hop
+} metricsNode_t;
+
+// us
+static const int32_t _metricsTimeBounds[METRICS_HISTOGRAM_BUCKETS] = {
+	50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000
+};
+// dBm
+static const int32_t _metricsRssiBounds[METRICS_HISTOGRAM_BUCKETS] = {
+	-120, -110, -100, -90, -80, -70, -60, -50, -40, -30, -20, -10
+};
+
+static metricsNode_t _metricsNodes[256];
+static uint32_t _metricsSignFailed = 0;
+static metricsHistogram_t _metricsForwardLatency;
+static metricsHistogram_t _metricsLoopBusy;
+static unsigned long _metricsRxMicros = 0;
+static unsigned long _metricsWakeMicros = 0;
+
+// Snapshot handshake with the scraping thread
+static pthread_mutex_t _metricsMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _metricsCond = PTHREAD_COND_INITIALIZER;
+static bool _metricsRequested = false;
+static bool _metricsReady = false;
+static std::string _metricsText;
+
+void metricsObserve(metricsHistogram_t &histogram, const int32_t *bounds, const int32_t value)
+{
+	uint8_t bucket = 0;
+	while (bucket < METRICS_HISTOGRAM_BUCKETS && value > bounds[bucket]) {
+		bucket++;
+	}
+	histogram.counts[bucket]++;
+	histogram.sum += value;
+}
+
+static int32_t _metricsElapsed(const unsigned long startMicros)
+{
+	const unsigned long elapsed = micros() - startMicros;
+	return elapsed > INT32_MAX ? INT32_MAX : (int32_t)elapsed;
+}
+
+void metricsRadioRx(const uint8_t sender, const uint8_t last, const int16_t rssi)
+{
+	_metricsRxMicros = micros();
+	_metricsNodes[sender].rx++;
+	if (rssi != INVALID_RSSI) {
+		metricsObserve(_metricsNodes[last].rssi, _metricsRssiBounds, rssi);
+	}
+}
+
+void metricsRadioTx(const uint8_t to, const bool result)
+{
+	_metricsNodes[to].tx++;
+	if (!result) {
+		_metricsNodes[to].txFailed++;
+	}
+}
+
+void metricsSignFailed(void)
+{
+	_metricsSignFailed++;
+}
+
+void metricsVerifyFailed(const uint8_t sender)
+{
+	_metricsNodes[sender].verifyFailed++;
+}
+
+void metricsGatewayForward(void)
+{
+	metricsObserve(_metricsForwardLatency, _metricsTimeBounds, _metricsElapsed(_metricsRxMicros));
+}
+
+void metricsLoopIdle(void)
+{
+	if (_metricsWakeMicros != 0) {
+		metricsObserve(_metricsLoopBusy, _metricsTimeBounds, _metricsElapsed(_metricsWakeMicros));
+	}
+}
+
+void metricsLoopWake(void)
+{
+	_metricsWakeMicros = micros();
+}
+
+static void _metricsAppend(std::string &text, const char *fmt, ...)
+{
+	char line[256];
+	va_list args;
+
+	va_start(args, fmt);
+	const int length = vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+	if (length > 0) {
+		text.append(line, (size_t)length < sizeof(line) ? (size_t)length : sizeof(line) - 1);
+	}
+}
+
+static void _metricsHeader(std::string &text, const char *name, const char *type, const char *help)
+{
+	_metricsAppend(text, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void _metricsHistogram(std::string &text, const char *name, const char *labels,
+                              const metricsHistogram_t &histogram, const int32_t *bounds, const double scale)
+{
+	const char *separator = labels[0] != '\0' ? "," : "";
+	uint32_t count = 0;
+
+	for (uint8_t bucket = 0; bucket < METRICS_HISTOGRAM_BUCKETS; bucket++) {
+		count += histogram.counts[bucket];
+		_metricsAppend(text, "%s_bucket{%s%sle=\"%g\"} %" PRIu32 "\n", name, labels, separator,
+		               bounds[bucket] * scale, count);
+	}
+	count += histogram.counts[METRICS_HISTOGRAM_BUCKETS];
+	_metricsAppend(text, "%s_bucket{%s%sle=\"+Inf\"} %" PRIu32 "\n", name, labels, separator, count);
+	const char *begin = labels[0] != '\0' ? "{" : "";
+	const char *end = labels[0] != '\0' ? "}" : "";
+	_metricsAppend(text, "%s_sum%s%s%s %g\n", name, begin, labels, end, histogram.sum * scale);
+	_metricsAppend(text, "%s_count%s%s%s %" PRIu32 "\n", name, begin, labels, end, count);
+}
+
+static void _metricsNodeCounter(std::string &text, const char *name, const char *help,
+                                uint32_t metricsNode_t::*counter)
+{
+	_metricsHeader(text, name, "counter", help);
+	for (uint16_t node = 0; node < 256; node++) {
+		const metricsNode_t &stats = _metricsNodes[node];
+		if (stats.rx != 0 || stats.tx != 0) {
+			_metricsAppend(text, "%s{node=\"%" PRIu16 "\"} %" PRIu32 "\n", name, node,
+			               stats.*counter);
+		}
+	}
+}
+
+#if defined(MY_GATEWAY_LINUX) && !defined(MY_GATEWAY_MQTT_CLIENT) && !defined(MY_GATEWAY_CLIENT_MODE)
+static void _metricsClients(std::string &text)
+{
+	gatewayTransportClientStats_t stats[MY_GATEWAY_MAX_CLIENTS];
+	bool connected[MY_GATEWAY_MAX_CLIENTS];
+	for (uint8_t slot = 0; slot < MY_GATEWAY_MAX_CLIENTS; slot++) {
+		connected[slot] = gatewayTransportGetClientStats(slot, &stats[slot]);
+	}
+	_metricsHeader(text, "mysensors_gateway_client_tx_queue_bytes", "gauge",
+	               "Bytes queued for a controller connection.");
+	for (uint8_t slot = 0; slot < MY_GATEWAY_MAX_CLIENTS; slot++) {
+		if (connected[slot]) {
+			_metricsAppend(text, "mysensors_gateway_client_tx_queue_bytes{slot=\"%" PRIu8 "\"} %" PRIu32
+			               "\n", slot, stats[slot].queuedBytes);
+		}
+	}
+	_metricsHeader(text, "mysensors_gateway_client_tx_queue_max_bytes", "gauge",
+	               "Highest number of bytes queued for a controller connection.");
+	for (uint8_t slot = 0; slot < MY_GATEWAY_MAX_CLIENTS; slot++) {
+		if (connected[slot]) {
+			_metricsAppend(text, "mysensors_gateway_client_tx_queue_max_bytes{slot=\"%" PRIu8 "\"} %"
+			               PRIu32 "\n", slot, stats[slot].maxQueuedBytes);
+		}
+	}
+	_metricsHeader(text, "mysensors_gateway_client_tx_queue_messages", "gauge",
+	               "Writes queued for a controller connection.");
+	for (uint8_t slot = 0; slot < MY_GATEWAY_MAX_CLIENTS; slot++) {
+		if (connected[slot]) {
+			_metricsAppend(text, "mysensors_gateway_client_tx_queue_messages{slot=\"%" PRIu8 "\"} %"
+			               PRIu32 "\n", slot, stats[slot].queuedMessages);
+		}
+	}
+	_metricsHeader(text, "mysensors_gateway_client_tx_lag_seconds", "gauge",
+	               "Age of the oldest write queued for a controller connection.");
+	for (uint8_t slot = 0; slot < MY_GATEWAY_MAX_CLIENTS; slot++) {
+		if (connected[slot]) {
+			_metricsAppend(text, "mysensors_gateway_client_tx_lag_seconds{slot=\"%" PRIu8 "\"} %.3f\n",
+			               slot, stats[slot].lagMs * 1e-3);
+		}
+	}
+	_metricsHeader(text, "mysensors_gateway_client_tx_dropped_total", "counter",
+	               "Writes dropped by the slow client policy of a controller connection.");
+	for (uint8_t slot = 0; slot < MY_GATEWAY_MAX_CLIENTS; slot++) {
+		if (connected[slot]) {
+			_metricsAppend(text, "mysensors_gateway_client_tx_dropped_total{slot=\"%" PRIu8 "\"} %"
+			               PRIu32 "\n", slot, stats[slot].dropped);
+		}
+	}
+}
+#endif
+
+static void _metricsFormat(std::string &text)
+{
+	char labels[16];
+
+	_metricsNodeCounter(text, "mysensors_node_rx_messages_total", "Messages received from a node.",
+	                    &metricsNode_t::rx);
+	_metricsNodeCounter(text, "mysensors_node_tx_messages_total",
+	                    "Radio transmissions to a node as next hop.", &metricsNode_t::tx);
+	_metricsNodeCounter(text, "mysensors_node_tx_failures_total",
+	                    "Radio transmissions to a node that were not acknowledged.",
+	                    &metricsNode_t::txFailed);
+	_metricsNodeCounter(text, "mysensors_node_verify_failures_total",
+	                    "Messages from a node that failed signature verification.",
+	                    &metricsNode_t::verifyFailed);
+
+	_metricsHeader(text, "mysensors_node_rssi_dbm", "histogram", "RSSI of receptions from a node.");
+	for (uint16_t node = 0; node < 256; node++) {
+		const metricsHistogram_t &rssi = _metricsNodes[node].rssi;
+		uint32_t count = 0;
+		for (uint8_t bucket = 0; bucket <= METRICS_HISTOGRAM_BUCKETS; bucket++) {
+			count += rssi.counts[bucket];
+		}
+		if (count != 0) {
+			(void)snprintf(labels, sizeof(labels), "node=\"%" PRIu16 "\"", node);
+			_metricsHistogram(text, "mysensors_node_rssi_dbm", labels, rssi, _metricsRssiBounds, 1.0);
+		}
+	}
+
+	_metricsHeader(text, "mysensors_sign_failures_total", "counter",
+	               "Outgoing messages that could not be signed.");
+	_metricsAppend(text, "mysensors_sign_failures_total %" PRIu32 "\n", _metricsSignFailed);
+
+#if defined(MY_RADIO_RF24) && defined(MY_RX_MESSAGE_BUFFER_FEATURE)
+	_metricsHeader(text, "mysensors_radio_rx_overflows_total", "counter",
+	               "Radio messages lost to a full receive queue, saturates at 255.");
+	_metricsAppend(text, "mysensors_radio_rx_overflows_total %" PRIu8 "\n",
+	               (uint8_t)transportLostMessageCount);
+#endif
+#if defined(MY_REPEATER_FEATURE)
+	_metricsHeader(text, "mysensors_routing_eeprom_writes_total", "counter",
+	               "Routing table bytes written to EEPROM.");
+	_metricsAppend(text, "mysensors_routing_eeprom_writes_total %" PRIu32 "\n",
+	               transportGetRoutingTableWrites());
+#endif
+
+	_metricsHeader(text, "mysensors_forward_latency_seconds", "histogram",
+	               "Time from radio reception to handing the message to the controller connection.");
+	_metricsHistogram(text, "mysensors_forward_latency_seconds", "", _metricsForwardLatency,
+	                  _metricsTimeBounds, 1e-6);
+	_metricsHeader(text, "mysensors_loop_busy_seconds", "histogram",
+	               "Time the main loop works between two waits.");
+	_metricsHistogram(text, "mysensors_loop_busy_seconds", "", _metricsLoopBusy, _metricsTimeBounds,
+	                  1e-6);
+
+#if defined(MY_GATEWAY_FEATURE)
+	const gatewayTransportRxQueueStats_t *rxQueue = gatewayTransportGetRxQueueStats();
+	_metricsHeader(text, "mysensors_gateway_rx_queue_depth", "gauge",
+	               "Controller messages waiting to be processed.");
+	_metricsAppend(text, "mysensors_gateway_rx_queue_depth %" PRIu8 "\n", rxQueue->depth);
+	_metricsHeader(text, "mysensors_gateway_rx_queue_max_depth", "gauge",
+	               "Highest number of controller messages waiting to be processed.");
+	_metricsAppend(text, "mysensors_gateway_rx_queue_max_depth %" PRIu8 "\n", rxQueue->maxDepth);
+	_metricsHeader(text, "mysensors_gateway_rx_messages_total", "counter",
+	               "Messages received from the controller.");
+	_metricsAppend(text, "mysensors_gateway_rx_messages_total %" PRIu32 "\n", rxQueue->received);
+	_metricsHeader(text, "mysensors_gateway_rx_deferred_total", "counter",
+	               "Loop iterations that left controller messages for the next one.");
+	_metricsAppend(text, "mysensors_gateway_rx_deferred_total %" PRIu32 "\n", rxQueue->deferred);
+#if defined(MY_LINUX_GATEWAY_THREADED)
+	gatewayTransportThreadStats_t thread;
+	gatewayTransportGetThreadStats(&thread);
+	_metricsHeader(text, "mysensors_gateway_thread_queue_depth", "gauge",
+	               "Messages queued between the core and the controller thread.");
+	_metricsAppend(text, "mysensors_gateway_thread_queue_depth{direction=\"to_core\"} %" PRIu32 "\n",
+	               (uint32_t)thread.toCoreDepth);
+	_metricsAppend(text,
+	               "mysensors_gateway_thread_queue_depth{direction=\"to_controller\"} %" PRIu32 "\n",
+	               (uint32_t)thread.toControllerDepth);
+	_metricsHeader(text, "mysensors_gateway_thread_stalls_total", "counter",
+	               "Times the controller thread waited for room in the queue to the core.");
+	_metricsAppend(text, "mysensors_gateway_thread_stalls_total %" PRIu32 "\n",
+	               (uint32_t)thread.toCoreStalls);
+	_metricsHeader(text, "mysensors_gateway_thread_dropped_total", "counter",
+	               "Messages to the controller dropped because the queue was full.");
+	_metricsAppend(text, "mysensors_gateway_thread_dropped_total %" PRIu32 "\n",
+	               (uint32_t)thread.toControllerDropped);
+#endif
+#if defined(MY_GATEWAY_LINUX) && !defined(MY_GATEWAY_MQTT_CLIENT) && !defined(MY_GATEWAY_CLIENT_MODE)
+	_metricsClients(text);
+#endif
+#endif
+
+	_metricsHeader(text, "mysensors_log_dropped_total", "counter",
+	               "Log lines dropped because the log writer fell behind.");
+	_metricsAppend(text, "mysensors_log_dropped_total %" PRIu32 "\n", logDropped());
+}
+
+void metricsProcess(void)
+{
+	if (!__atomic_load_n(&_metricsRequested, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+	std::string text;
+	text.reserve(_metricsText.capacity());
+	_metricsFormat(text);
+
+	pthread_mutex_lock(&_metricsMutex);
+	_metricsText.swap(text);
+	__atomic_store_n(&_metricsRequested, false, __ATOMIC_RELAXED);
+	_metricsReady = true;
+	pthread_cond_signal(&_metricsCond);
+	pthread_mutex_unlock(&_metricsMutex);
+}
+
+bool metricsSnapshot(std::string &text, const uint32_t timeoutMS)
+{
+	struct timespec deadline;
+	int result = 0;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeoutMS / 1000;
+	deadline.tv_nsec += (long)(timeoutMS % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&_metricsMutex);
+	_metricsReady = false;
+	__atomic_store_n(&_metricsRequested, true, __ATOMIC_RELEASE);
+	eventLoopWakeup();
+	while (!_metricsReady && result == 0) {
+		result = pthread_cond_timedwait(&_metricsCond, &_metricsMutex, &deadline);
+	}
+	const bool ready = _metricsReady;
+	if (ready) {
+		text = _metricsText;
+	}
+	pthread_mutex_unlock(&_metricsMutex);
+	return ready;
+}
@@ -0,0 +1,117 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file MyMetrics.h
+ *
+ * @brief API declaration for MyMetrics
+ * @defgroup MyMetricsgrp MyMetrics
+ * @ingroup internals
+ * @{
+ *
+ * @brief Gateway metrics in the Prometheus text format, enabled by MY_LINUX_METRICS.
+ *
+ * The counters are only updated by the main loop, so they are plain integers. A scrape asks
+ * the main loop for a text snapshot with metricsSnapshot() and waits for metricsProcess() to
+ * produce it.
+ */
+#ifndef MyMetrics_h
+#define MyMetrics_h
+
+#if !defined(__linux__)
+#error MY_LINUX_METRICS is only supported on Linux
+#endif
+
+#include <string>
+
+#define METRICS_HISTOGRAM_BUCKETS (12u)	//!< Upper bounds per histogram, +Inf excluded
+
+/**
+ * @brief Histogram with cumulative Prometheus buckets computed when formatted
+ */
+typedef struct {
+	uint32_t counts[METRICS_HISTOGRAM_BUCKETS + 1];	//!< Observations per bucket, +Inf last
+	int64_t sum;		//!< Sum of all observations
+} metricsHistogram_t;
+
+/**
+ * @brief Add a value to a histogram
+ * @param histogram to update
+ * @param bounds METRICS_HISTOGRAM_BUCKETS ascending upper bounds
+ * @param value observed
+ */
+void metricsObserve(metricsHistogram_t &histogram, const int32_t *bounds, const int32_t value);
+
+/**
+ * @brief Count a message received by the radio
+ * @param sender Node that sent the message
+ * @param last Node the message was received from
+ * @param rssi of the reception, INVALID_RSSI if not available
+ */
+void metricsRadioRx(const uint8_t sender, const uint8_t last, const int16_t rssi);
+
+/**
+ * @brief Count a radio transmission
+ * @param to Next hop
+ * @param result of the transmission, false if not acknowledged
+ */
+void metricsRadioTx(const uint8_t to, const bool result);
+
+/**
+ * @brief Count a message that could not be signed
+ */
+void metricsSignFailed(void);
+
+/**
+ * @brief Count a message that failed signature verification
+ * @param sender Node that sent the message
+ */
+void metricsVerifyFailed(const uint8_t sender);
+
+/**
+ * @brief Record the latency of the last received radio message handed to the controller
+ */
+void metricsGatewayForward(void);
+
+/**
+ * @brief Mark the main loop going idle, records the time it was busy
+ */
+void metricsLoopIdle(void);
+
+/**
+ * @brief Mark the main loop waking up
+ */
+void metricsLoopWake(void);
+
+/**
+ * @brief Produce a requested snapshot, called by the main loop
+ */
+void metricsProcess(void);
+
+/**
+ * @brief Get the metrics text from the main loop, called from another thread
+ * @param text Receives the metrics
+ * @param timeoutMS Time to wait for the main loop
+ * @return false if the main loop did not respond in time
+ */
+bool metricsSnapshot(std::string &text, const uint32_t timeoutMS);
+
+#endif /* MyMetrics_h */
+
+/** @}*/
@@ -0,0 +1,291 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyOTAFirmwareCache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// FIRMWARE_BLOCK_SIZE of the nodes, see MyOTAFirmwareUpdate.h
+#if MAX_PAYLOAD_SIZE >= 22
+#define OTA_CACHE_BLOCK_SIZE		(16u)
+#else
+#define OTA_CACHE_BLOCK_SIZE		(8u)
+#endif
+#define OTA_CACHE_MAX_BLOCKS		(MY_LINUX_OTA_CACHE_IMAGE_SIZE / OTA_CACHE_BLOCK_SIZE)
+#define OTA_CACHE_MAGIC				(0x4F53594Du)	// "MYSO"
+#define OTA_CACHE_HEADER_SIZE		(6u)	// type, version and block of FW requests and responses
+#define OTA_CACHE_BROADCASTS		(64u)	// recent broadcasts remembered
+#define OTA_CACHE_BROADCAST_HOLDOFF_MS	(250u)	// below MY_OTA_RETRY_DELAY of the nodes
+#define OTA_CACHE_ACTIVE_MS			(10000u)	// nodes requesting within this time share broadcasts
+
+typedef struct {
+	uint16_t type;			// FW type, version, blocks and crc of the config response
+	uint16_t version;
+	uint16_t blocks;		// 0 if unused
+	uint16_t crc;
+	uint32_t used;			// sequence of the last use, the least recently used image is replaced
+	uint8_t present[OTA_CACHE_MAX_BLOCKS / 8];
+	uint8_t data[OTA_CACHE_MAX_BLOCKS * OTA_CACHE_BLOCK_SIZE];
+} otaCacheImage_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t images;		// geometry the file was created with
+	uint32_t imageSize;
+	uint32_t sequence;
+	otaCacheImage_t image[MY_LINUX_OTA_CACHE_IMAGES];
+} otaCache_t;
+
+static_assert(MY_LINUX_OTA_CACHE_IMAGES <= INT8_MAX,
+              "MY_LINUX_OTA_CACHE_IMAGES exceeds the int8_t image index");
+
+static otaCache_t *_otaCache = NULL;
+static int8_t _otaCacheNode[256];	// image fetched by the node, -1 if none
+
+#if defined(MY_LINUX_OTA_MULTICAST)
+typedef struct {
+	uint32_t ms;
+	uint16_t block;
+	int8_t image;
+} otaCacheBroadcast_t;
+
+static uint32_t _otaCacheNodeSeen[256];
+static otaCacheBroadcast_t _otaCacheBroadcasts[OTA_CACHE_BROADCASTS];
+static uint8_t _otaCacheBroadcastNext = 0;
+#endif
+
+void otaCacheInit(const char *file)
+{
+	(void)memset(_otaCacheNode, -1, sizeof(_otaCacheNode));
+	if (file) {
+		const int fd = open(file, O_RDWR | O_CREAT, 0644);
+		if (fd < 0 || ftruncate(fd, sizeof(otaCache_t)) != 0) {
+			logError("ota cache: %s: %s\n", file, strerror(errno));
+		} else {
+			void *map = mmap(NULL, sizeof(otaCache_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (map == MAP_FAILED) {
+				logError("ota cache: mmap %s: %s\n", file, strerror(errno));
+			} else {
+				_otaCache = (otaCache_t *)map;
+			}
+		}
+		if (fd >= 0) {
+			(void)close(fd);
+		}
+	}
+	if (!_otaCache) {
+		_otaCache = (otaCache_t *)calloc(1, sizeof(otaCache_t));
+		if (!_otaCache) {
+			logError("ota cache: out of memory\n");
+			return;
+		}
+	}
+	if (_otaCache->magic != OTA_CACHE_MAGIC || _otaCache->images != MY_LINUX_OTA_CACHE_IMAGES ||
+	        _otaCache->imageSize != MY_LINUX_OTA_CACHE_IMAGE_SIZE) {
+		(void)memset(_otaCache, 0, sizeof(otaCache_t));
+		_otaCache->magic = OTA_CACHE_MAGIC;
+		_otaCache->images = MY_LINUX_OTA_CACHE_IMAGES;
+		_otaCache->imageSize = MY_LINUX_OTA_CACHE_IMAGE_SIZE;
+	}
+}
+
+static uint16_t _otaCacheRead16(const MyMessage &message, const uint8_t offset)
+{
+	const uint8_t *data = (const uint8_t *)message.data;
+	return data[offset] | (uint16_t)(data[offset + 1] << 8);
+}
+
+static otaCacheImage_t *_otaCacheNodeImage(const uint8_t node, const MyMessage &message)
+{
+	const int8_t image = _otaCacheNode[node];
+	if (!_otaCache || image < 0 || message.getLength() < OTA_CACHE_HEADER_SIZE) {
+		return NULL;
+	}
+	otaCacheImage_t *entry = &_otaCache->image[image];
+	if (entry->type != _otaCacheRead16(message, 0) || entry->version != _otaCacheRead16(message, 2)) {
+		return NULL;
+	}
+	entry->used = ++_otaCache->sequence;
+	return entry;
+}
+
+static void _otaCacheStore(otaCacheImage_t *entry, const uint16_t block, const uint8_t *data)
+{
+	if (block < entry->blocks) {
+		(void)memcpy(&entry->data[block * OTA_CACHE_BLOCK_SIZE], data, OTA_CACHE_BLOCK_SIZE);
+		entry->present[block / 8] |= 1u << (block % 8);
+	}
+}
+
+static bool _otaCachePresent(const otaCacheImage_t *entry, const uint16_t block)
+{
+	return block < entry->blocks && (entry->present[block / 8] & (1u << (block % 8)));
+}
+
+static void _otaCacheConfig(const uint8_t node, const MyMessage &message)
+{
+	_otaCacheNode[node] = -1;
+	// encoded images (FOTA 3.2, encoding at offset 9) are specific to the node
+	if (message.getLength() < 8 || (message.getLength() >= 12 && message.data[9] != 0)) {
+		return;
+	}
+	const uint16_t type = _otaCacheRead16(message, 0);
+	const uint16_t version = _otaCacheRead16(message, 2);
+	const uint16_t blocks = _otaCacheRead16(message, 4);
+	const uint16_t crc = _otaCacheRead16(message, 6);
+	if (!blocks || blocks > OTA_CACHE_MAX_BLOCKS) {
+		return;
+	}
+	int8_t image = 0;
+	for (uint8_t i = 0; i < MY_LINUX_OTA_CACHE_IMAGES; i++) {
+		const otaCacheImage_t *entry = &_otaCache->image[i];
+		if (entry->blocks && entry->type == type && entry->version == version) {
+			image = i;
+			break;
+		}
+		if (entry->used < _otaCache->image[image].used) {
+			image = i;
+		}
+	}
+	otaCacheImage_t *entry = &_otaCache->image[image];
+	if (!entry->blocks || entry->type != type || entry->version != version || entry->blocks != blocks ||
+	        entry->crc != crc) {
+		GATEWAY_DEBUG(PSTR("GWT:OTA:CACHE,T=%04" PRIX16 ",V=%04" PRIX16 ",B=%04" PRIX16 "\n"), type,
+		              version, blocks);
+		(void)memset(entry->present, 0, sizeof(entry->present));
+		entry->type = type;
+		entry->version = version;
+		entry->blocks = blocks;
+		entry->crc = crc;
+	}
+	entry->used = ++_otaCache->sequence;
+	_otaCacheNode[node] = image;
+#if defined(MY_LINUX_OTA_MULTICAST)
+	_otaCacheNodeSeen[node] = hwMillis();
+#endif
+}
+
+void otaCacheSnoop(const MyMessage &message)
+{
+	const uint8_t node = message.getDestination();
+	if (!_otaCache || message.getCommand() != C_STREAM || node == BROADCAST_ADDRESS) {
+		return;
+	}
+	const uint8_t type = message.getType();
+	if (type == ST_FIRMWARE_CONFIG_RESPONSE) {
+		_otaCacheConfig(node, message);
+	} else if (type == ST_FIRMWARE_RESPONSE) {
+		otaCacheImage_t *entry = _otaCacheNodeImage(node, message);
+		if (entry && message.getLength() >= OTA_CACHE_HEADER_SIZE + OTA_CACHE_BLOCK_SIZE) {
+			_otaCacheStore(entry, _otaCacheRead16(message, 4),
+			               (const uint8_t *)&message.data[OTA_CACHE_HEADER_SIZE]);
+		}
+	} else if (type == ST_FIRMWARE_RESPONSE_RLE) {
+		// number of blocks and fill byte follow the header
+		otaCacheImage_t *entry = _otaCacheNodeImage(node, message);
+		if (entry && message.getLength() >= OTA_CACHE_HEADER_SIZE + 3) {
+			uint8_t data[OTA_CACHE_BLOCK_SIZE];
+			(void)memset(data, message.data[OTA_CACHE_HEADER_SIZE + 2], sizeof(data));
+			uint16_t block = _otaCacheRead16(message, 4);
+			uint16_t count = _otaCacheRead16(message, OTA_CACHE_HEADER_SIZE);
+			while (count--) {
+				_otaCacheStore(entry, block, data);
+				if (!block--) {
+					break;
+				}
+			}
+		}
+	}
+}
+
+#if defined(MY_LINUX_OTA_MULTICAST)
+// true if the block was broadcast recently, remembers the broadcast otherwise
+static bool _otaCacheBroadcastRecent(const int8_t image, const uint16_t block, const uint32_t now)
+{
+	for (uint8_t i = 0; i < OTA_CACHE_BROADCASTS; i++) {
+		const otaCacheBroadcast_t *broadcast = &_otaCacheBroadcasts[i];
+		if (broadcast->image == image && broadcast->block == block && broadcast->ms != 0 &&
+		        now - broadcast->ms < OTA_CACHE_BROADCAST_HOLDOFF_MS) {
+			return true;
+		}
+	}
+	otaCacheBroadcast_t *broadcast = &_otaCacheBroadcasts[_otaCacheBroadcastNext];
+	_otaCacheBroadcastNext = (_otaCacheBroadcastNext + 1) % OTA_CACHE_BROADCASTS;
+	broadcast->ms = now;
+	broadcast->block = block;
+	broadcast->image = image;
+	return false;
+}
+#endif
+
+bool otaCacheRequest(const MyMessage &message)
+{
+	const uint8_t node = message.getSender();
+	const otaCacheImage_t *entry = _otaCacheNodeImage(node, message);
+	if (!entry) {
+		return false;
+	}
+	// FOTA 3.2 range requests add the number of blocks, counting down from block
+	const uint16_t block = _otaCacheRead16(message, 4);
+	const uint8_t count = message.getLength() > OTA_CACHE_HEADER_SIZE ?
+	                      (uint8_t)message.data[OTA_CACHE_HEADER_SIZE] : 1u;
+	if (!count || count > block + 1u) {
+		return false;
+	}
+	for (uint8_t i = 0; i < count; i++) {
+		if (!_otaCachePresent(entry, block - i)) {
+			return false;
+		}
+	}
+	uint8_t destination = node;
+#if defined(MY_LINUX_OTA_MULTICAST)
+	const int8_t image = _otaCacheNode[node];
+	const uint32_t now = hwMillis();
+	_otaCacheNodeSeen[node] = now;
+	for (uint16_t other = 0; other < BROADCAST_ADDRESS; other++) {
+		if (other != node && _otaCacheNode[other] == image &&
+		        now - _otaCacheNodeSeen[other] < OTA_CACHE_ACTIVE_MS) {
+			destination = BROADCAST_ADDRESS;
+			break;
+		}
+	}
+#endif
+	GATEWAY_DEBUG(PSTR("GWT:OTA:HIT,ID=%" PRIu8 ",B=%04" PRIX16 ",N=%" PRIu8 ",BC=%" PRIu8 "\n"), node,
+	              block, count, destination == BROADCAST_ADDRESS);
+	uint8_t payload[OTA_CACHE_HEADER_SIZE + OTA_CACHE_BLOCK_SIZE];
+	(void)memcpy(payload, message.data, 4);
+	for (uint8_t i = 0; i < count; i++) {
+		const uint16_t current = block - i;
+#if defined(MY_LINUX_OTA_MULTICAST)
+		if (destination == BROADCAST_ADDRESS && _otaCacheBroadcastRecent(image, current, now)) {
+			continue;
+		}
+#endif
+		payload[4] = (uint8_t)current;
+		payload[5] = (uint8_t)(current >> 8);
+		(void)memcpy(&payload[OTA_CACHE_HEADER_SIZE], &entry->data[current * OTA_CACHE_BLOCK_SIZE],
+		             OTA_CACHE_BLOCK_SIZE);
+		(void)transportSendRoute(build(_msgTmp, destination, NODE_SENSOR_ID, C_STREAM,
+		                               ST_FIRMWARE_RESPONSE, false).set(payload, sizeof(payload)));
+	}
+	return true;
+}
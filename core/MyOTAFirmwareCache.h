@@ -0,0 +1,73 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file MyOTAFirmwareCache.h
+ *
+ * @brief API declaration for MyOTAFirmwareCache
+ * @defgroup MyOTAFirmwareCachegrp MyOTAFirmwareCache
+ * @ingroup internals
+ * @{
+ *
+ * @brief Gateway cache of FW images, enabled by MY_LINUX_OTA_CACHE.
+ *
+ * The FW config responses and blocks the controller sends to nodes are kept per FW type and
+ * version. A block request is answered by the gateway when all requested blocks are cached,
+ * otherwise it is forwarded to the controller, whose responses fill the cache. Encoded images
+ * (FOTA 3.2) are node specific and not cached. With MY_LINUX_OTA_MULTICAST, cached blocks are
+ * broadcast while several nodes fetch the same image, nodes missing a block request it again.
+ *
+ * The images are kept in memory, or in the file set by ota_cache_file in the config file.
+ *
+ * Log messages:
+ *
+ * |E| SYS | SUB | Message                       | Comment
+ * |-|-----|-----|-------------------------------|------------------------------------------------
+ * | | GWT | OTA | CACHE,T=%04X,V=%04X,B=%04X   | Caching FW type (T), version (V), blocks (B)
+ * | | GWT | OTA | HIT,ID=%%d,B=%04X,N=%%d,BC=%%d | Request of node (ID) for blocks (B, N) answered, broadcast (BC)
+ */
+#ifndef MyOTAFirmwareCache_h
+#define MyOTAFirmwareCache_h
+
+#if !defined(__linux__)
+#error MY_LINUX_OTA_CACHE is only supported on Linux
+#endif
+
+/**
+ * @brief Set up the cache storage
+ * @param file to map the cache to, NULL to cache in memory only
+ */
+void otaCacheInit(const char *file);
+
+/**
+ * @brief Store the FW config or block of a message from the controller to a node
+ * @param message C_STREAM message from the controller
+ */
+void otaCacheSnoop(const MyMessage &message);
+
+/**
+ * @brief Answer a FW block request from the cache
+ * @param message ST_FIRMWARE_REQUEST from a node
+ * @return true if answered, false if the request has to be forwarded to the controller
+ */
+bool otaCacheRequest(const MyMessage &message);
+
+#endif
+
+/** @}*/
@@ -34,21 +34,46 @@ SPIFlash _flash(MY_OTA_FLASH_SS, MY_OTA_FLASH_JDECID);
 #ifndef MCUBOOT_PRESENT
 #define _flash_initialize()	_flash.initialize()
 #define _flash_readByte(addr)	_flash.readByte(addr)
+#define _flash_readBytes(addr, buf, len)	_flash.readBytes(addr, buf, len)
 #define _flash_writeBytes( dstaddr, data, size) _flash.writeBytes( dstaddr, data, size)
 #define  _flash_blockErase32K(num)  _flash.blockErase32K(num)
 #define _flash_busy() _flash.busy()
 #else
 #define _flash_initialize()	true
 #define _flash_readByte(addr)	(*((uint8_t *)(addr)))
+#define _flash_readBytes(addr, buf, len)	memcpy(buf, (void *)(addr), len)
 #define  _flash_blockErase32K(num)  Flash.erase((uint32_t *)FLASH_AREA_IMAGE_1_OFFSET_0, FLASH_AREA_IMAGE_1_SIZE_0)
 #define _flash_busy() false
 #endif
 
+#ifdef MY_OTA_COMPRESSION_FEATURE
+// Map installed FW, source of delta copies
+#if defined(ARDUINO_ARCH_AVR)
+#if FLASHEND > 0xFFFFul
+#define _firmware_readInstalled(addr)	pgm_read_byte_far(addr)
+#else
+#define _firmware_readInstalled(addr)	pgm_read_byte((uint16_t)(addr))
+#endif
+#define FIRMWARE_INSTALLED_SIZE	(FLASHEND + 1ul)
+#define FIRMWARE_ENCODINGS	(FIRMWARE_ENCODING_LZ | FIRMWARE_ENCODING_DELTA)
+#else
+#define FIRMWARE_ENCODINGS	(FIRMWARE_ENCODING_LZ)
+#endif
+#endif
+
 LOCAL nodeFirmwareConfig_t _nodeFirmwareConfig;
 LOCAL bool _firmwareUpdateOngoing = false;
 LOCAL uint32_t _firmwareLastRequest;
 LOCAL uint16_t _firmwareBlock;
 LOCAL uint8_t _firmwareRetry;
+#ifdef FIRMWARE_PROTOCOL_32
+LOCAL uint8_t _firmwareWindow;			// negotiated window, 1 = one block per request
+LOCAL uint32_t _firmwareWindowMissing;	// bit n set: block (_firmwareBlock - 1 - n) outstanding
+#endif
+#ifdef MY_OTA_COMPRESSION_FEATURE
+LOCAL uint8_t _firmwareEncoding;
+LOCAL uint16_t _firmwareEncodedBlocks;
+#endif
 LOCAL bool _firmwareResponse(uint16_t block, uint8_t *data);
 
 LOCAL void readFirmwareSettings(void)
@@ -57,6 +82,44 @@ LOCAL void readFirmwareSettings(void)
 	                  sizeof(nodeFirmwareConfig_t));
 }
 
+LOCAL uint32_t _firmwareStagingAddress(const uint16_t block)
+{
+	const uint32_t offset = (uint32_t)block * FIRMWARE_BLOCK_SIZE;
+#ifdef MY_OTA_COMPRESSION_FEATURE
+	if (_firmwareEncoding != FIRMWARE_ENCODING_RAW) {
+		return offset + MY_OTA_ENCODED_OFFSET;
+	}
+#endif
+	return offset + FIRMWARE_START_OFFSET;
+}
+
+#ifdef FIRMWARE_PROTOCOL_32
+LOCAL uint8_t _firmwareWindowBlocks(void)
+{
+	return _firmwareBlock < _firmwareWindow ? (uint8_t)_firmwareBlock : _firmwareWindow;
+}
+
+LOCAL void _firmwareWindowStart(void)
+{
+	const uint8_t blocks = _firmwareWindowBlocks();
+	_firmwareWindowMissing = blocks < 32 ? (1ul << blocks) - 1 : 0xFFFFFFFFul;
+}
+
+LOCAL void _firmwareRequestBlocks(const uint16_t block, const uint8_t count)
+{
+	requestFirmwareBlocks_t firmwareRequest;
+	firmwareRequest.type = _nodeFirmwareConfig.type;
+	firmwareRequest.version = _nodeFirmwareConfig.version;
+	firmwareRequest.block = block;
+	firmwareRequest.number_of_blocks = count;
+	OTA_DEBUG(PSTR("OTA:FRQ:FW REQ,T=%04" PRIX16 ",V=%04" PRIX16 ",B=%04" PRIX16 ",N=%" PRIu8 "\n"),
+	          _nodeFirmwareConfig.type,
+	          _nodeFirmwareConfig.version, block, count); // request FW update blocks
+	(void)_sendRoute(build(_msgTmp, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_STREAM, ST_FIRMWARE_REQUEST,
+	                       false).set(&firmwareRequest, sizeof(requestFirmwareBlocks_t)));
+}
+#endif
+
 LOCAL void firmwareOTAUpdateRequest(void)
 {
 	const uint32_t enterMS = hwMillis();
@@ -70,6 +133,23 @@ LOCAL void firmwareOTAUpdateRequest(void)
 		}
 		_firmwareRetry--;
 		_firmwareLastRequest = enterMS;
+#ifdef FIRMWARE_PROTOCOL_32
+		if (_firmwareWindow > 1) {
+			// (re-)request each run of outstanding blocks in the window
+			uint8_t offset = 0;
+			while (offset < _firmwareWindow) {
+				uint8_t count = 0;
+				while (offset + count < _firmwareWindow && (_firmwareWindowMissing >> (offset + count)) & 1) {
+					count++;
+				}
+				if (count) {
+					_firmwareRequestBlocks(_firmwareBlock - 1 - offset, count);
+				}
+				offset += count + 1;
+			}
+			return;
+		}
+#endif
 		// Time to (re-)request firmware block from controller
 		requestFirmwareBlock_t firmwareRequest;
 		firmwareRequest.type = _nodeFirmwareConfig.type;
@@ -83,6 +163,13 @@ LOCAL void firmwareOTAUpdateRequest(void)
 	}
 }
 
+// blocks of another FW, or broadcast for other nodes while no update is ongoing, are dropped silently
+LOCAL bool _firmwareBlockWanted(const uint16_t type, const uint16_t version)
+{
+	return type == _nodeFirmwareConfig.type && version == _nodeFirmwareConfig.version &&
+	       (_firmwareUpdateOngoing || _msg.getDestination() == getNodeId());
+}
+
 LOCAL bool firmwareOTAUpdateProcess(void)
 {
 	if (_msg.getType() == ST_FIRMWARE_CONFIG_RESPONSE) {
@@ -93,6 +180,36 @@ LOCAL bool firmwareOTAUpdateProcess(void)
 		nodeFirmwareConfig_t *firmwareConfigResponse = (nodeFirmwareConfig_t *)_msg.data;
 		// compare with current node configuration, if they differ, start FW fetch process
 		if (memcmp(&_nodeFirmwareConfig, firmwareConfigResponse, sizeof(nodeFirmwareConfig_t))) {
+#ifdef FIRMWARE_PROTOCOL_32
+			// controllers supporting the 3.2 extensions append window and encoding
+			const replyFirmwareConfig_t *firmwareConfigReply = (replyFirmwareConfig_t *)_msg.data;
+			_firmwareWindow = 1;
+			if (_msg.getLength() > offsetof(replyFirmwareConfig_t, window)) {
+				const uint8_t window = firmwareConfigReply->window;
+				_firmwareWindow = window > MY_OTA_WINDOW_SIZE ? MY_OTA_WINDOW_SIZE : (window ? window : 1);
+			}
+			OTA_DEBUG(PSTR("OTA:FWP:WIN=%" PRIu8 "\n"), _firmwareWindow);
+#endif
+#ifdef MY_OTA_COMPRESSION_FEATURE
+			_firmwareEncoding = FIRMWARE_ENCODING_RAW;
+			if (_msg.getLength() >= sizeof(replyFirmwareConfig_t) &&
+			        firmwareConfigReply->encoding != FIRMWARE_ENCODING_RAW) {
+				_firmwareEncoding = firmwareConfigReply->encoding;
+				_firmwareEncodedBlocks = firmwareConfigReply->encodedBlocks;
+				OTA_DEBUG(PSTR("OTA:FWP:ENC=%" PRIu8 ",B=%04" PRIX16 "\n"), _firmwareEncoding,
+				          _firmwareEncodedBlocks);
+				// the encoded image is staged in a single 32K block, which the decoded image
+				// must not reach
+				if ((_firmwareEncoding & ~FIRMWARE_ENCODINGS) || !_firmwareEncodedBlocks ||
+				        (uint32_t)_firmwareEncodedBlocks * FIRMWARE_BLOCK_SIZE > 0x8000ul ||
+				        (uint32_t)firmwareConfigResponse->blocks * FIRMWARE_BLOCK_SIZE + FIRMWARE_START_OFFSET >
+				        MY_OTA_ENCODED_OFFSET) {
+					OTA_DEBUG(PSTR("!OTA:FWP:ENC=%" PRIu8 " INVALID\n"), _firmwareEncoding);
+					_firmwareEncoding = FIRMWARE_ENCODING_RAW;
+					return true;
+				}
+			}
+#endif
 			setIndication(INDICATION_FW_UPDATE_START);
 			OTA_DEBUG(PSTR("OTA:FWP:UPDATE\n"));	// FW update initiated
 			// copy new FW config
@@ -108,6 +225,17 @@ LOCAL bool firmwareOTAUpdateProcess(void)
 				// wait until flash erased
 				while ( _flash_busy() ) {}
 				_firmwareBlock = _nodeFirmwareConfig.blocks;
+#ifdef MY_OTA_COMPRESSION_FEATURE
+				if (_firmwareEncoding != FIRMWARE_ENCODING_RAW) {
+					// fetch the encoded image, decoded once complete
+					_flash_blockErase32K(MY_OTA_ENCODED_OFFSET);
+					while ( _flash_busy() ) {}
+					_firmwareBlock = _firmwareEncodedBlocks;
+				}
+#endif
+#ifdef FIRMWARE_PROTOCOL_32
+				_firmwareWindowStart();
+#endif
 				_firmwareUpdateOngoing = true;
 				// reset flags
 				_firmwareRetry = MY_OTA_RETRY + 1;
@@ -119,6 +247,9 @@ LOCAL bool firmwareOTAUpdateProcess(void)
 	} else if (_msg.getType() == ST_FIRMWARE_RESPONSE) {
 		// extract FW block
 		replyFirmwareBlock_t *firmwareResponse = (replyFirmwareBlock_t *)_msg.data;
+		if (!_firmwareBlockWanted(firmwareResponse->type, firmwareResponse->version)) {
+			return true;
+		}
 		// Proceed firmware data
 		return _firmwareResponse(firmwareResponse->block, firmwareResponse->data);
 #ifdef FIRMWARE_PROTOCOL_31
@@ -126,6 +257,9 @@ LOCAL bool firmwareOTAUpdateProcess(void)
 		// RLE encoded block
 		// extract FW block
 		replyFirmwareBlockRLE_t *firmwareResponse = (replyFirmwareBlockRLE_t *)_msg.data;
+		if (!_firmwareBlockWanted(firmwareResponse->type, firmwareResponse->version)) {
+			return true;
+		}
 		uint8_t data[FIRMWARE_BLOCK_SIZE];
 		for (uint8_t i=0; i<FIRMWARE_BLOCK_SIZE; i++) {
 			data[i]=firmwareResponse->data;
@@ -182,6 +316,14 @@ LOCAL void presentBootloaderInformation(void)
 	requestFirmwareConfig->img_revision = *((uint16_t*)(MCUBOOT_IMAGE_0_IMG_REVISION_ADDR));
 	requestFirmwareConfig->img_build_num = *((uint16_t*)(MCUBOOT_IMAGE_0_IMG_BUILD_NUM_ADDR));
 #endif
+#endif
+#ifdef FIRMWARE_PROTOCOL_32
+	requestFirmwareConfig->window = MY_OTA_WINDOW_SIZE;
+#ifdef MY_OTA_COMPRESSION_FEATURE
+	requestFirmwareConfig->encodings = FIRMWARE_ENCODINGS;
+#else
+	requestFirmwareConfig->encodings = FIRMWARE_ENCODING_RAW;
+#endif
 #endif
 	_firmwareUpdateOngoing = false;
 	(void)_sendRoute(build(_msgTmp, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_STREAM,
@@ -192,20 +334,31 @@ LOCAL bool isFirmwareUpdateOngoing(void)
 {
 	return _firmwareUpdateOngoing;
 }
-// do a crc16 on the whole received firmware
+// crc16 (0xA001), one nibble per table lookup
+LOCAL uint16_t _firmwareCRC(uint16_t crc, const uint8_t *data, uint8_t length)
+{
+	static const uint16_t table[16] PROGMEM = {
+		0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+		0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400
+	};
+	while (length--) {
+		const uint8_t dataByte = *data++;
+		crc = (crc >> 4) ^ pgm_read_word(&table[(crc ^ dataByte) & 0x0F]);
+		crc = (crc >> 4) ^ pgm_read_word(&table[(crc ^ (dataByte >> 4)) & 0x0F]);
+	}
+	return crc;
+}
+
+// do a crc16 on the whole firmware as written to flash, decoded images included
 LOCAL bool transportIsValidFirmware(void)
 {
 	// init crc
 	uint16_t crc = ~0;
-	for (uint32_t i = 0; i < _nodeFirmwareConfig.blocks * FIRMWARE_BLOCK_SIZE; ++i) {
-		crc ^= _flash_readByte(i + FIRMWARE_START_OFFSET);
-		for (int8_t j = 0; j < 8; ++j) {
-			if (crc & 1) {
-				crc = (crc >> 1) ^ 0xA001;
-			} else {
-				crc = (crc >> 1);
-			}
-		}
+	uint8_t buffer[FIRMWARE_BLOCK_SIZE];
+	for (uint16_t block = 0; block < _nodeFirmwareConfig.blocks; block++) {
+		_flash_readBytes((uint32_t)block * FIRMWARE_BLOCK_SIZE + FIRMWARE_START_OFFSET, buffer,
+		                 FIRMWARE_BLOCK_SIZE);
+		crc = _firmwareCRC(crc, buffer, FIRMWARE_BLOCK_SIZE);
 	}
 	OTA_DEBUG(PSTR("OTA:CRC:B=%04" PRIX16 ",C=%04" PRIX16 ",F=%04" PRIX16 "\n"),
 	          _nodeFirmwareConfig.blocks,crc,
@@ -213,27 +366,122 @@ LOCAL bool transportIsValidFirmware(void)
 	return crc == _nodeFirmwareConfig.crc;
 }
 
+#ifdef MY_OTA_COMPRESSION_FEATURE
+// decode the staged image into the FW image, see FIRMWARE_PROTOCOL_32
+LOCAL bool _firmwareDecode(void)
+{
+	if (_firmwareEncoding == FIRMWARE_ENCODING_RAW) {
+		return true;
+	}
+	OTA_DEBUG(PSTR("OTA:FWP:DECODE\n"));
+	const uint32_t inputEnd = MY_OTA_ENCODED_OFFSET + (uint32_t)_firmwareEncodedBlocks *
+	                          FIRMWARE_BLOCK_SIZE;
+	const uint32_t outputEnd = (uint32_t)_nodeFirmwareConfig.blocks * FIRMWARE_BLOCK_SIZE;
+	uint32_t input = MY_OTA_ENCODED_OFFSET;
+	uint32_t output = 0;
+	// decoded bytes of the current block, written to flash once the block is complete
+	uint8_t buffer[FIRMWARE_BLOCK_SIZE];
+	while (output < outputEnd && input < inputEnd) {
+		const uint8_t op = _flash_readByte(input++);
+		uint16_t length;
+		uint32_t source = 0;
+		if (op < FIRMWARE_OP_MATCH) {
+			length = op + 1u;
+		} else {
+			length = (op & FIRMWARE_OP_LENGTH_EXT) + FIRMWARE_OP_LENGTH_MIN;
+			if ((op & FIRMWARE_OP_LENGTH_EXT) == FIRMWARE_OP_LENGTH_EXT && input < inputEnd) {
+				length += _flash_readByte(input++);
+			}
+			if (input + 2 > inputEnd) {
+				break;
+			}
+			const uint16_t param = _flash_readByte(input) | (uint16_t)(_flash_readByte(input + 1) << 8);
+			input += 2;
+			if (op < FIRMWARE_OP_INSTALLED) {
+				if (!param || param > output) {
+					break;
+				}
+				source = output - param;
+			} else {
+#ifdef _firmware_readInstalled
+				const int32_t installed = (int32_t)output + (int16_t)param;
+				if (!(_firmwareEncoding & FIRMWARE_ENCODING_DELTA) || installed < 0 ||
+				        (uint32_t)installed + length > FIRMWARE_INSTALLED_SIZE) {
+					break;
+				}
+				source = (uint32_t)installed;
+#else
+				break;
+#endif
+			}
+		}
+		if (length > outputEnd - output) {
+			break;
+		}
+		while (length--) {
+			uint8_t data;
+			if (op < FIRMWARE_OP_MATCH) {
+				if (input >= inputEnd) {
+					break;
+				}
+				data = _flash_readByte(input++);
+			} else if (op < FIRMWARE_OP_INSTALLED) {
+				// source may still be in the buffer
+				data = source >= output - (output % FIRMWARE_BLOCK_SIZE) ? buffer[source % FIRMWARE_BLOCK_SIZE] :
+				       _flash_readByte(source + FIRMWARE_START_OFFSET);
+				source++;
+			} else {
+#ifdef _firmware_readInstalled
+				data = _firmware_readInstalled(source++);
+#else
+				data = 0;	// rejected above
+#endif
+			}
+			buffer[output % FIRMWARE_BLOCK_SIZE] = data;
+			if (!(++output % FIRMWARE_BLOCK_SIZE)) {
+				_flash_writeBytes(output - FIRMWARE_BLOCK_SIZE + FIRMWARE_START_OFFSET, buffer,
+				                  FIRMWARE_BLOCK_SIZE);
+				while (_flash_busy()) {}
+			}
+		}
+	}
+	if (output != outputEnd) {
+		OTA_DEBUG(PSTR("!OTA:FWP:DECODE FAIL\n"));
+		return false;
+	}
+	return true;
+}
+#endif
+
 LOCAL bool _firmwareResponse(uint16_t block, uint8_t *data)
 {
 	if (_firmwareUpdateOngoing) {
 		OTA_DEBUG(PSTR("OTA:FWP:RECV B=%04" PRIX16 "\n"), block);	// received FW block
+#ifdef FIRMWARE_PROTOCOL_32
+		// offset of the block in the current window, blocks outside or already received are dropped
+		const uint16_t offset = _firmwareBlock - 1 - block;
+		if (block >= _firmwareBlock || offset >= _firmwareWindowBlocks() ||
+		        !((_firmwareWindowMissing >> offset) & 1)) {
+#else
 		if (block != _firmwareBlock - 1) {
+#endif
 			OTA_DEBUG(PSTR("!OTA:FWP:WRONG FWB\n"));	// received FW block
-			// wrong firmware block received
-			setIndication(INDICATION_FW_UPDATE_RX_ERR);
+			// wrong firmware block received, broadcast blocks may belong to other nodes' windows
+			if (_msg.getDestination() == getNodeId()) {
+				setIndication(INDICATION_FW_UPDATE_RX_ERR);
+			}
 			// no further processing required
 			return true;
 		}
 		setIndication(INDICATION_FW_UPDATE_RX);
 		// Save block to flash
 #ifdef MCUBOOT_PRESENT
-		uint32_t addr = ((size_t)(((_firmwareBlock - 1) * FIRMWARE_BLOCK_SIZE)) + (size_t)(
-		                     FIRMWARE_START_OFFSET));
+		uint32_t addr = _firmwareStagingAddress(block);
 		if (addr<FLASH_AREA_IMAGE_SCRATCH_OFFSET_0) {
 			Flash.write_block( (uint32_t *)addr, (uint32_t *)data, FIRMWARE_BLOCK_SIZE>>2);
 		}
 #else
-		_flash_writeBytes( ((_firmwareBlock - 1) * FIRMWARE_BLOCK_SIZE) + FIRMWARE_START_OFFSET,
+		_flash_writeBytes( _firmwareStagingAddress(block),
 		                   data, FIRMWARE_BLOCK_SIZE);
 #endif
 		// wait until flash written
@@ -241,7 +489,7 @@ LOCAL bool _firmwareResponse(uint16_t block, uint8_t *data)
 #ifdef OTA_EXTRA_FLASH_DEBUG
 		{
 			char prbuf[8];
-			uint32_t addr = ((_firmwareBlock - 1) * FIRMWARE_BLOCK_SIZE) + FIRMWARE_START_OFFSET;
+			uint32_t addr = _firmwareStagingAddress(block);
 			OTA_DEBUG(PSTR("OTA:FWP:FL DUMP "));
 			sprintf_P(prbuf,PSTR("%04" PRIX16 ":"), (uint16_t)addr);
 			MY_SERIALDEVICE.print(prbuf);
@@ -253,12 +501,28 @@ LOCAL bool _firmwareResponse(uint16_t block, uint8_t *data)
 			OTA_DEBUG(PSTR("\n"));
 		}
 #endif
+#ifdef FIRMWARE_PROTOCOL_32
+		_firmwareWindowMissing &= ~(1ul << offset);
+		if (_firmwareWindowMissing) {
+			// window incomplete, re-request outstanding blocks if no further block arrives
+			_firmwareRetry = MY_OTA_RETRY + 1;
+			_firmwareLastRequest = hwMillis();
+			return true;
+		}
+		_firmwareBlock -= _firmwareWindowBlocks();
+		_firmwareWindowStart();
+#else
 		_firmwareBlock--;
+#endif
 		if (!_firmwareBlock) {
 			// We're done! Do a checksum and reboot.
 			OTA_DEBUG(PSTR("OTA:FWP:FW END\n"));	// received FW block
 			_firmwareUpdateOngoing = false;
-			if (transportIsValidFirmware()) {
+			bool valid = true;
+#ifdef MY_OTA_COMPRESSION_FEATURE
+			valid = _firmwareDecode();
+#endif
+			if (valid && transportIsValidFirmware()) {
 				OTA_DEBUG(PSTR("OTA:FWP:CRC OK\n"));	// FW checksum ok
 				// Write the new firmware config to eeprom
 				hwWriteConfigBlock((void*)&_nodeFirmwareConfig, (void*)EEPROM_FIRMWARE_TYPE_ADDRESS,
@@ -40,12 +40,18 @@
 * |!| OTA | FWP | UPDO                        | FW config response received, FW update already ongoing
 * |!| OTA | FWP | FLASH INIT FAIL             | Failed to initialise flash
 * | | OTA | FWP | UPDATE SKIPPED              | FW update skipped, no newer version available
+* | | OTA | FWP | WIN=%%d                      | FW blocks requested at once (window), negotiated with controller
 * | | OTA | FWP | RECV B=%04X                 | Received FW block (B)
 * |!| OTA | FWP | WRONG FWB                   | Wrong FW block received
 * | | OTA | FWP | FW END                      | FW received, proceed to CRC verification
+* | | OTA | FWP | ENC=%%d,B=%04X               | Encoded FW image announced, encoding (ENC), encoded blocks (B)
+* |!| OTA | FWP | ENC=%%d INVALID              | Encoding not supported or encoded image too large, FW update skipped
+* | | OTA | FWP | DECODE                      | Encoded FW received, decode into FW image
+* |!| OTA | FWP | DECODE FAIL                 | Encoded FW image corrupt
 * | | OTA | FWP | CRC OK                      | FW CRC verification OK
 * |!| OTA | FWP | CRC FAIL                    | FW CRC verification failed
 * | | OTA | FRQ | FW REQ,T=%04X,V=%04X,B=%04X | Request FW update, FW type (T), version (V), block (B)
+* | | OTA | FRQ | FW REQ,T=%04X,V=%04X,B=%04X,N=%%d | Request FW blocks, FW type (T), version (V), highest block (B), number of blocks (N)
 * |!| OTA | FRQ | FW UPD FAIL                 | FW update failed
 * | | OTA | CRC | B=%04X,C=%04X,F=%04X        | FW CRC verification. FW blocks (B), calculated CRC (C), FW CRC (F)
 *
@@ -79,6 +85,24 @@
 #ifndef MY_OTA_RETRY_DELAY
 #define MY_OTA_RETRY_DELAY		(500u)				//!< Number of milliseconds before re-requesting a FW block
 #endif
+#ifndef MY_OTA_WINDOW_SIZE
+#define MY_OTA_WINDOW_SIZE		(1u)				//!< Max number of FW blocks requested at once, values > 1 enable FOTA 3.2
+#endif
+#ifndef MY_OTA_ENCODED_OFFSET
+#define MY_OTA_ENCODED_OFFSET	(0x8000ul)			//!< Flash offset of the encoded FW image, start of a 32K block
+#endif
+#if MY_OTA_WINDOW_SIZE > 32
+#error MY_OTA_WINDOW_SIZE must not exceed 32
+#endif
+#if defined(MY_OTA_COMPRESSION_FEATURE) && defined(MCUBOOT_PRESENT)
+#error MY_OTA_COMPRESSION_FEATURE requires external flash
+#endif
+#if MY_OTA_WINDOW_SIZE > 1 || defined(MY_OTA_COMPRESSION_FEATURE)
+#define FIRMWARE_PROTOCOL_32
+#ifndef FIRMWARE_PROTOCOL_31
+#define FIRMWARE_PROTOCOL_31
+#endif
+#endif
 #ifndef MCUBOOT_PRESENT
 #define FIRMWARE_START_OFFSET	(10u)				//!< Start offset for firmware in flash (DualOptiboot wants to keeps a signature first)
 #else
@@ -86,13 +110,25 @@
 #endif
 
 #define MY_OTA_BOOTLOADER_MAJOR_VERSION (3u)		//!< Bootloader version major
-#ifdef FIRMWARE_PROTOCOL_31
+#if defined(FIRMWARE_PROTOCOL_32)
+#define MY_OTA_BOOTLOADER_MINOR_VERSION (2u)		//!< Bootloader version minor
+#elif defined(FIRMWARE_PROTOCOL_31)
 #define MY_OTA_BOOTLOADER_MINOR_VERSION (1u)		//!< Bootloader version minor
 #else
 #define MY_OTA_BOOTLOADER_MINOR_VERSION (0u)		//!< Bootloader version minor
 #endif
 #define MY_OTA_BOOTLOADER_VERSION (MY_OTA_BOOTLOADER_MINOR_VERSION * 256 + MY_OTA_BOOTLOADER_MAJOR_VERSION)	//!< Bootloader version
 
+#define FIRMWARE_ENCODING_RAW	(0x00u)				//!< FW image sent as is
+#define FIRMWARE_ENCODING_LZ	(0x01u)				//!< FW image LZ compressed
+#define FIRMWARE_ENCODING_DELTA	(0x02u)				//!< FW image LZ compressed, with copies from the installed FW
+
+#define FIRMWARE_OP_LITERAL		(0x00u)				//!< Encoded FW op: (op + 1) literal bytes follow
+#define FIRMWARE_OP_MATCH		(0x80u)				//!< Encoded FW op: copy from the decoded image, uint16 distance back follows
+#define FIRMWARE_OP_INSTALLED	(0xC0u)				//!< Encoded FW op: copy from the installed FW, int16 offset to current position follows
+#define FIRMWARE_OP_LENGTH_MIN	(3u)				//!< Shortest copy, copy length = (op & 0x3F) + FIRMWARE_OP_LENGTH_MIN
+#define FIRMWARE_OP_LENGTH_EXT	(0x3Fu)				//!< Copy length field value announcing an additional length byte
+
 #if defined(MY_DEBUG_VERBOSE_OTA_UPDATE)
 #define OTA_DEBUG(x,...) DEBUG_OUTPUT(x, ##__VA_ARGS__)	//!< debug
 //#define OTA_EXTRA_FLASH_DEBUG	//!< Dumps flash after each FW block
@@ -111,6 +147,34 @@
 #define FIRMWARE_PROTOCOL_31
 #endif
 
+#if defined(DOXYGEN) && !defined(FIRMWARE_PROTOCOL_32)
+/**
+ * @brief Enabled FOTA 3.2 protocol extensions
+ *
+ * Adds windowed transfers on top of FOTA 3.1: the node announces @ref MY_OTA_WINDOW_SIZE in the
+ * config request, the controller appends the accepted window to the config response and the node
+ * requests up to that many blocks per message. Missing blocks of a window are re-requested after
+ * @ref MY_OTA_RETRY_DELAY. Without a window in the response, blocks are requested one by one.
+ *
+ * With @ref MY_OTA_COMPRESSION_FEATURE the node also announces the image encodings it can decode.
+ * The controller may then send an encoded image: the config response carries the encoding and the
+ * number of encoded blocks, block requests and responses address the encoded image. The encoded
+ * image is staged at @ref MY_OTA_ENCODED_OFFSET and decoded into the FW image once complete.
+ * The encoded image is a sequence of ops:
+ * - 0x00-0x7F: (op + 1) literal bytes follow
+ * - 0x80-0xBF: copy from the decoded image, followed by the uint16 distance back from the current position
+ * - 0xC0-0xFF: copy from the installed FW (@ref FIRMWARE_ENCODING_DELTA), followed by the int16
+ *   offset of the source relative to the current position
+ *
+ * The copy length is (op & 0x3F) + 3. A length field of 0x3F is followed by a byte, which is added
+ * to the length before the distance or offset. Multi-byte values are little endian.
+ *
+ * The extension is enabled when @ref MY_OTA_WINDOW_SIZE is larger than 1 or @ref MY_OTA_COMPRESSION_FEATURE
+ * is defined.
+ */
+#define FIRMWARE_PROTOCOL_32
+#endif
+
 /**
 * @brief FW config structure, stored in eeprom
 */
@@ -136,8 +200,25 @@ typedef struct {
 	uint16_t img_revision;							//!< mcuboot revision attribute, when protocol version >= 3.1 is reported
 	uint32_t img_build_num;							//!< mcuboot build_num attribute, when protocol version >= 3.1 is reported
 #endif
+#ifdef FIRMWARE_PROTOCOL_32
+	uint8_t  window;							//!< Max number of blocks per FW request, when protocol version >= 3.2 is reported
+	uint8_t  encodings;							//!< Decodable FW image encodings (FIRMWARE_ENCODING_*), when protocol version >= 3.2 is reported
+#endif
 } __attribute__((packed)) requestFirmwareConfig_t;
 
+/**
+* @brief FW config response structure (protocol version >= 3.2)
+*/
+typedef struct {
+	uint16_t type;								//!< Type of config
+	uint16_t version;							//!< Version of config
+	uint16_t blocks;							//!< Number of blocks
+	uint16_t crc;								//!< CRC of block data
+	uint8_t  window;							//!< Accepted number of blocks per FW request, omitted by controllers without windowed transfers
+	uint8_t  encoding;							//!< FW image encoding (FIRMWARE_ENCODING_*), omitted for raw images
+	uint16_t encodedBlocks;						//!< Number of encoded blocks, omitted for raw images
+} __attribute__((packed)) replyFirmwareConfig_t;
+
 /**
 * @brief FW block request structure
 */
@@ -147,6 +228,16 @@ typedef struct {
 	uint16_t block;								//!< Block index
 } __attribute__((packed)) requestFirmwareBlock_t;
 
+/**
+* @brief FW block range request structure (protocol version >= 3.2)
+*/
+typedef struct {
+	uint16_t type;								//!< Type of config
+	uint16_t version;							//!< Version of config
+	uint16_t block;								//!< Highest block index
+	uint8_t  number_of_blocks;						//!< Number of blocks, counting down from block
+} __attribute__((packed)) requestFirmwareBlocks_t;
+
 /**
 * @brief  FW block reply structure
 */
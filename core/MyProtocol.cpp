@@ -26,83 +26,217 @@
 char _fmtBuffer[MY_GATEWAY_MAX_SEND_LENGTH];
 char _convBuffer[MAX_PAYLOAD_SIZE * 2 + 1];
 
-bool protocolSerial2MyMessage(MyMessage &message, char *inputString)
+// Five header fields of up to three digits, with delimiters
+#define PROTOCOL_HEADER_MAX_LENGTH (5 * 3 + 4)
+
+static uint8_t protocolH2I(const char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return 0xFF;
+}
+
+static char *protocolFormatUint8(char *str, uint8_t value)
+{
+	if (value >= 100) {
+		*str++ = '0' + value / 100;
+		value %= 100;
+		*str++ = '0' + value / 10;
+		value %= 10;
+	} else if (value >= 10) {
+		*str++ = '0' + value / 10;
+		value %= 10;
+	}
+	*str++ = '0' + value;
+	return str;
+}
+
+// Format sender, sensor, command, echo and type, separated by delimiter
+static char *protocolFormatHeader(char *str, const MyMessage &message, const char delimiter)
+{
+	str = protocolFormatUint8(str, message.getSender());
+	*str++ = delimiter;
+	str = protocolFormatUint8(str, message.getSensor());
+	*str++ = delimiter;
+	str = protocolFormatUint8(str, message.getCommand());
+	*str++ = delimiter;
+	str = protocolFormatUint8(str, message.isEcho());
+	*str++ = delimiter;
+	return protocolFormatUint8(str, message.getType());
+}
+
+// Append up to n characters of str at buffer[length], keeping it null terminated
+static size_t protocolAppend(char *buffer, size_t length, const size_t size, const char *str,
+                             size_t n)
+{
+	if (n > size - 1 - length) {
+		n = size - 1 - length;
+	}
+	(void)memcpy(buffer + length, str, n);
+	length += n;
+	buffer[length] = 0;
+	return length;
+}
+
+// Parse destination, sensor, command, echo and type, separated by delimiter.
+// On success, *input points past the type field (and its trailing delimiter).
+static protocolError_t protocolParseHeader(MyMessage &message, const char **input,
+        const char delimiter)
 {
-	char *str, *p;
-	uint8_t index = 0;
-	mysensors_command_t command = C_INVALID_7;
+	const char *str = *input;
+	uint8_t field[5];
+
+	for (uint8_t index = 0; index < 5; index++) {
+		const char *start = str;
+		uint16_t value = 0;
+		while (*str >= '0' && *str <= '9' && value <= 0xFF) {
+			value = value * 10 + (*str++ - '0');
+		}
+		const protocolError_t error = static_cast<protocolError_t>(PROTOCOL_ERR_DESTINATION + index);
+		if (str == start || value > 0xFF) {
+			return error;
+		}
+		if (*str == delimiter) {
+			str++;
+		} else if (index < 4 || (*str != '\0' && *str != '\r' && *str != '\n')) {
+			// only the type field may end the input
+			return error;
+		}
+		field[index] = static_cast<uint8_t>(value);
+	}
+	if (field[2] > C_STREAM) {
+		return PROTOCOL_ERR_COMMAND;
+	}
+	if (field[3] > 1) {
+		return PROTOCOL_ERR_ECHO;
+	}
+
 	message.setSender(GATEWAY_ADDRESS);
 	message.setLast(GATEWAY_ADDRESS);
 	message.setEcho(false);
+	message.setDestination(field[0]);
+	message.setSensor(field[1]);
+	message.setCommand(static_cast<mysensors_command_t>(field[2]));
+	message.setRequestEcho(field[3]);
+	message.setType(field[4]);
+	*input = str;
+	return PROTOCOL_OK;
+}
 
-	// Extract command data coming on serial line
-	for (str = strtok_r(inputString, ";", &p); // split using semicolon
-	        str && index < 5; // loop while str is not null an max 4 times
-	        str = strtok_r(NULL, ";", &p), index++ // get subsequent tokens
-	    ) {
-		switch (index) {
-		case 0: // Radio id (destination)
-			message.setDestination(atoi(str));
-			break;
-		case 1: // Child id
-			message.setSensor(atoi(str));
-			break;
-		case 2: // Message type
-			command = static_cast<mysensors_command_t>(atoi(str));
-			message.setCommand(command);
-			break;
-		case 3: // Should we request echo from destination?
-			message.setRequestEcho(atoi(str) ? 1 : 0);
-			break;
-		case 4: // Data type
-			message.setType(atoi(str));
-			break;
+// Set a string payload, or a hex encoded one for C_STREAM
+static protocolError_t protocolParsePayload(MyMessage &message, const char *str,
+        const size_t length)
+{
+	if (message.getCommand() == C_STREAM) {
+		uint8_t bvalue[MAX_PAYLOAD_SIZE];
+		if ((length & 1) || length > sizeof(bvalue) * 2) {
+			return PROTOCOL_ERR_PAYLOAD;
+		}
+		for (uint8_t i = 0; i < length / 2; i++) {
+			const uint8_t high = protocolH2I(str[i * 2]);
+			const uint8_t low = protocolH2I(str[i * 2 + 1]);
+			if ((high | low) > 0x0F) {
+				return PROTOCOL_ERR_PAYLOAD;
+			}
+			bvalue[i] = (high << 4) | low;
 		}
+		message.set(bvalue, length / 2);
+	} else {
+		// Too long strings are truncated
+		message.setLength(length > MAX_PAYLOAD_SIZE ? MAX_PAYLOAD_SIZE : length);
+		message.setPayloadType(P_STRING);
+		(void)memcpy(message.data, str, message.getLength());
+		message.data[message.getLength()] = 0;
+	}
+	return PROTOCOL_OK;
+}
+
+protocolError_t protocolParseSerial(MyMessage &message, const char *input)
+{
+	const protocolError_t error = protocolParseHeader(message, &input, ';');
+	if (error != PROTOCOL_OK) {
+		return error;
+	}
+
+	size_t length = strlen(input);
+	// Remove trailing carriage returns and newline characters, e.g. of "\r\n"
+	while (length > 0 && (input[length - 1] == '\r' || input[length - 1] == '\n')) {
+		length--;
 	}
-	// payload
-	if (str == NULL) {
+	if (length == 0) {
 		// no payload, set default value
 		message.set((uint8_t)0);
-	} else if (command == C_STREAM) {
-		// stream payload
-		uint8_t bvalue[MAX_PAYLOAD_SIZE];
-		uint8_t blen = 0;
-		while (*str) {
-			uint8_t val;
-			val = convertH2I(*str++) << 4;
-			val += convertH2I(*str++);
-			bvalue[blen] = val;
-			blen++;
-		}
-		message.set(bvalue, blen);
-	} else {
-		// regular payload
-		char *value = str;
-		// Remove trailing carriage return and newline character (if it exists)
-		const uint8_t lastCharacter = strlen(value) - 1;
-		if (value[lastCharacter] == '\r' || value[lastCharacter] == '\n') {
-			value[lastCharacter] = '\0';
-		}
-		message.set(value);
+		return PROTOCOL_OK;
+	}
+	return protocolParsePayload(message, input, length);
+}
+
+size_t protocolFormatPayload(const MyMessage &message, char *buffer, const size_t size)
+{
+	char payload[MAX_PAYLOAD_SIZE * 2 + 1];
+
+	if (size == 0) {
+		return 0;
+	}
+	if (size >= sizeof(payload)) {
+		// The longest representation fits, convert in place
+		buffer[0] = 0;
+		(void)message.getString(buffer);
+		return strlen(buffer);
+	}
+	payload[0] = 0;
+	(void)message.getString(payload);
+	return protocolAppend(buffer, 0, size, payload, strlen(payload));
+}
+
+size_t protocolFormatSerial(const MyMessage &message, char *buffer, const size_t size)
+{
+	char header[PROTOCOL_HEADER_MAX_LENGTH + 1];
+
+	if (size == 0) {
+		return 0;
 	}
-	return (index == 5);
+	char *str = protocolFormatHeader(header, message, ';');
+	*str++ = ';';
+	size_t length = protocolAppend(buffer, 0, size, header, str - header);
+	length += protocolFormatPayload(message, buffer + length, size - length);
+	// truncate like snprintf() would
+	return protocolAppend(buffer, length, size, "\n", 1);
+}
+
+size_t protocolFormatMQTTTopic(const char *prefix, const MyMessage &message, char *buffer,
+                               const size_t size)
+{
+	char header[1 + PROTOCOL_HEADER_MAX_LENGTH];
+
+	if (size == 0) {
+		return 0;
+	}
+	header[0] = '/';
+	const char *str = protocolFormatHeader(header + 1, message, '/');
+	const size_t length = protocolAppend(buffer, 0, size, prefix, strlen(prefix));
+	return protocolAppend(buffer, length, size, header, str - header);
+}
+
+bool protocolSerial2MyMessage(MyMessage &message, char *inputString)
+{
+	return protocolParseSerial(message, inputString) == PROTOCOL_OK;
 }
 
 char *protocolMyMessage2Serial(const MyMessage &message)
 {
-	(void)snprintf_P(_fmtBuffer, (uint8_t)MY_GATEWAY_MAX_SEND_LENGTH,
-	                 PSTR("%" PRIu8 ";%" PRIu8 ";%" PRIu8 ";%" PRIu8 ";%" PRIu8 ";%s\n"), message.getSender(),
-	                 message.getSensor(), message.getCommand(), message.isEcho(), message.getType(),
-	                 message.getString(_convBuffer));
+	(void)protocolFormatSerial(message, _fmtBuffer, sizeof(_fmtBuffer));
 	return _fmtBuffer;
 }
 
 char *protocolMyMessage2MQTT(const char *prefix, const MyMessage &message)
 {
-	(void)snprintf_P(_fmtBuffer, (uint8_t)MY_GATEWAY_MAX_SEND_LENGTH,
-	                 PSTR("%s/%" PRIu8 "/%" PRIu8 "/%" PRIu8 "/%" PRIu8 "/%" PRIu8 ""), prefix,
-	                 message.getSender(), message.getSensor(), message.getCommand(), message.isEcho(),
-	                 message.getType());
+	(void)protocolFormatMQTTTopic(prefix, message, _fmtBuffer, sizeof(_fmtBuffer));
 	return _fmtBuffer;
 }
 
@@ -110,58 +244,8 @@ char *protocolMyMessage2MQTT(const char *prefix, const MyMessage &message)
 bool protocolMQTT2MyMessage(MyMessage &message, char *topic, uint8_t *payload,
                             const unsigned int length)
 {
-	char *str, *p;
-	uint8_t index = 0;
-	message.setSender(GATEWAY_ADDRESS);
-	message.setLast(GATEWAY_ADDRESS);
-	message.setEcho(false);
-	for (str = strtok_r(topic + strlen(MY_MQTT_SUBSCRIBE_TOPIC_PREFIX) + 1, "/", &p);
-	        str && index < 5;
-	        str = strtok_r(NULL, "/", &p), index++
-	    ) {
-		switch (index) {
-		case 0:
-			// Node id
-			message.setDestination(atoi(str));
-			break;
-		case 1:
-			// Sensor id
-			message.setSensor(atoi(str));
-			break;
-		case 2: {
-			// Command type
-			const mysensors_command_t command = static_cast<mysensors_command_t>(atoi(str));
-			message.setCommand(command);
-			// Add payload
-			if (command == C_STREAM) {
-				uint8_t bvalue[MAX_PAYLOAD_SIZE];
-				uint8_t blen = 0;
-				while (*payload) {
-					uint8_t val;
-					val = convertH2I(*payload++) << 4;
-					val += convertH2I(*payload++);
-					bvalue[blen] = val;
-					blen++;
-				}
-				message.set(bvalue, blen);
-			} else {
-				// terminate string
-				char *value = (char *)payload;
-				value[length] = '\0';
-				message.set((const char*)payload);
-			}
-			break;
-		}
-		case 3:
-			// Echo flag
-			message.setRequestEcho(atoi(str) ? 1 : 0);
-			break;
-		case 4:
-			// Sub type
-			message.setType(atoi(str));
-			break;
-		}
-	}
+	const char *str = topic + strlen(MY_MQTT_SUBSCRIBE_TOPIC_PREFIX) + 1;
 	// Return true if input valid
-	return (index == 5);
+	return protocolParseHeader(message, &str, '/') == PROTOCOL_OK &&
+	       protocolParsePayload(message, (const char *)payload, length) == PROTOCOL_OK;
 }
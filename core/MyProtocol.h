@@ -22,6 +22,40 @@
 
 #include "MySensorsCore.h"
 
+/// @brief Result of parsing a message in serial or MQTT protocol format
+typedef enum {
+	PROTOCOL_OK              = 0,	//!< Message parsed
+	PROTOCOL_ERR_DESTINATION = 1,	//!< Node id missing or out of range
+	PROTOCOL_ERR_SENSOR      = 2,	//!< Child id missing or out of range
+	PROTOCOL_ERR_COMMAND     = 3,	//!< Command missing or unknown
+	PROTOCOL_ERR_ECHO        = 4,	//!< Echo flag missing or not 0/1
+	PROTOCOL_ERR_TYPE        = 5,	//!< Type missing or out of range
+	PROTOCOL_ERR_PAYLOAD     = 6	//!< Stream payload not valid hex or too long
+} protocolError_t;
+
+// Parse a node;child;cmd;echo;type;payload line into message, without
+// modifying the input. Returns PROTOCOL_OK or the first invalid field.
+protocolError_t protocolParseSerial(MyMessage &message, const char *input);
+
+// Format message to the serial protocol representation, newline terminated,
+// into a caller provided buffer. Truncates like snprintf() and returns the
+// number of characters written, without the terminating null character.
+size_t protocolFormatSerial(const MyMessage &message, char *buffer, const size_t size);
+
+// Format the MQTT topic prefix/sender/sensor/command/echo/type for message
+// into a caller provided buffer. Truncates like snprintf() and returns the
+// length.
+size_t protocolFormatMQTTTopic(const char *prefix, const MyMessage &message, char *buffer,
+                               const size_t size);
+
+// Format the payload of message as text (hex for binary payloads) into a
+// caller provided buffer. Truncates like snprintf() and returns the length.
+size_t protocolFormatPayload(const MyMessage &message, char *buffer, const size_t size);
+
+// The functions above are reentrant. protocolMyMessage2Serial() and
+// protocolMyMessage2MQTT() below return a shared static buffer instead, which
+// is overwritten by the next call.
+
 // parse(message, inputString)
 // parse a string into a message element
 // returns true if successfully parsed the input string
@@ -22,8 +22,15 @@
 // debug output
 #if defined(MY_DEBUG_VERBOSE_CORE)
 #define CORE_DEBUG(x,...)	DEBUG_OUTPUT(x, ##__VA_ARGS__)	//!< debug
+#if defined(MY_DEBUG_TRACE)
+// Formats assembled from configuration macros cannot be looked up by the trace decoder
+#define CORE_DEBUG_TEXT(x,...)	do { traceFlush(); hwDebugPrint(x, ##__VA_ARGS__); } while (0)	//!< debug
+#else
+#define CORE_DEBUG_TEXT(x,...)	CORE_DEBUG(x, ##__VA_ARGS__)	//!< debug
+#endif
 #else
 #define CORE_DEBUG(x,...)	//!< debug NULL
+#define CORE_DEBUG_TEXT(x,...)	//!< debug NULL
 #endif
 
 // message buffers
@@ -54,7 +61,86 @@ void _callbackTransportReady(void)
 	}
 }
 
-void _process(void)
+#if defined(__linux__)
+// Time to block in _process(), bounded by pending work and core timers
+static uint32_t _processIdleTime(uint32_t maxIdleMS)
+{
+	maxIdleMS = min(maxIdleMS, (uint32_t)MY_LINUX_EVENT_LOOP_TIMEOUT_MS);
+#if defined(MY_SENSOR_NETWORK)
+#if defined(MY_RADIO_RF24) && !defined(MY_RX_MESSAGE_BUFFER_FEATURE)
+	// no IRQ, radio must be polled
+	maxIdleMS = min(maxIdleMS, (uint32_t)MY_LINUX_RADIO_POLL_INTERVAL_MS);
+#endif
+	maxIdleMS = min(maxIdleMS, transportTimeToNextEvent());
+#endif
+#if defined(MY_DEFAULT_TX_LED_PIN) || defined(MY_DEFAULT_RX_LED_PIN) || defined(MY_DEFAULT_ERR_LED_PIN)
+	if (ledsBlinking()) {
+		maxIdleMS = min(maxIdleMS, (uint32_t)LED_PROCESS_INTERVAL_MS);
+	}
+#endif
+	return maxIdleMS;
+}
+#endif
+
+#if defined(MY_GATEWAY_FEATURE) && defined(MY_SENSOR_NETWORK)
+#define PROCESS_BUDGET_SCALE_MAX	(4u)	// max turn length, in multiples of the configured budget
+
+// Process one turn of a source. A source that uses up its turn has a backlog, its next turn is
+// twice as long, up to PROCESS_BUDGET_SCALE_MAX times its budget. A turn that drains the source
+// resets it.
+static bool _processTurn(bool (*process)(const uint8_t), const uint8_t budget, uint8_t &scale)
+{
+	const bool pending = process((uint8_t)min((uint16_t)(budget * scale), (uint16_t)UINT8_MAX));
+	scale = pending ? (uint8_t)min((unsigned int)(scale * 2u), PROCESS_BUDGET_SCALE_MAX) : 1u;
+	return pending;
+}
+#endif
+
+#if defined(MY_GATEWAY_FEATURE) || defined(MY_SENSOR_NETWORK)
+// Gateways process controller and radio messages in alternating turns while either has messages
+// pending, until the time budget is used up. The next call starts with the turn that was cut off,
+// so neither source starves the other or the sketch loop(). Nodes process one turn per call.
+static void _processMessages(void)
+{
+	bool pending;
+#if defined(MY_GATEWAY_FEATURE) && defined(MY_SENSOR_NETWORK)
+	const uint32_t startMS = hwMillis();
+	static bool radioTurn = false;
+	static uint8_t radioScale = 1;
+	static uint8_t controllerScale = 1;
+	bool controllerPending = true;
+	bool radioPending = true;
+	do {
+		if (radioTurn) {
+			radioPending = _processTurn(transportProcessFIFO, MY_TRANSPORT_RX_PROCESS_BUDGET, radioScale);
+		} else {
+			controllerPending = _processTurn(gatewayTransportProcess, MY_GATEWAY_RX_PROCESS_BUDGET,
+			                                 controllerScale);
+		}
+		radioTurn = !radioTurn;
+		pending = controllerPending || radioPending;
+	} while (pending && hwMillis() - startMS < MY_PROCESS_TIME_BUDGET_MS);
+#elif defined(MY_GATEWAY_FEATURE)
+	const uint32_t startMS = hwMillis();
+	while ((pending = gatewayTransportProcess(MY_GATEWAY_RX_PROCESS_BUDGET)) &&
+	        hwMillis() - startMS < MY_PROCESS_TIME_BUDGET_MS) {
+	}
+#else
+	pending = transportProcessFIFO(MY_TRANSPORT_RX_PROCESS_BUDGET);
+#endif
+	if (pending) {
+#if defined(MY_GATEWAY_FEATURE)
+		gatewayTransportDeferred();
+#endif
+#if defined(__linux__)
+		// budget exhausted, do not sleep before the next iteration
+		eventLoopPending();
+#endif
+	}
+}
+#endif
+
+void _process(const uint32_t maxIdleMS)
 {
 #if defined(MY_DEBUG_VERBOSE_CORE)
 	if (processLock) {
@@ -68,17 +154,35 @@ void _process(void)
 	inclusionProcess();
 #endif
 
-#if defined(MY_GATEWAY_FEATURE)
-	gatewayTransportProcess();
+#if defined(MY_SENSOR_NETWORK)
+	transportUpdateSM();
 #endif
+#if defined(MY_GATEWAY_FEATURE) || defined(MY_SENSOR_NETWORK)
+	_processMessages();
+#endif
+	signerProcessPending();
 
-#if defined(MY_SENSOR_NETWORK)
-	transportProcess();
+#if defined(MY_DEBUG_TRACE)
+	traceFlush();
 #endif
 
 #if defined(__linux__)
-	// To avoid high cpu usage
-	usleep(10000); // 10ms
+	// Batched EEPROM changes are written back when due
+	const uint32_t configSyncMS = hwConfigSync();
+#if defined(MY_DEBUG_LATENCY)
+	latencyProcess();
+#endif
+#if defined(MY_LINUX_METRICS)
+	metricsProcess();
+	metricsLoopIdle();
+#endif
+	// Sleep until I/O or a radio IRQ is pending, or a timer is due
+	(void)eventLoopWait(min(_processIdleTime(maxIdleMS), configSyncMS));
+#if defined(MY_LINUX_METRICS)
+	metricsLoopWake();
+#endif
+#else
+	(void)maxIdleMS;
 #endif
 #if defined(MY_DEBUG_VERBOSE_CORE)
 	processLock--;
@@ -120,14 +224,14 @@ void _begin(void)
 #endif
 
 #if defined(F_CPU)
-	CORE_DEBUG(PSTR("MCO:BGN:INIT " MY_NODE_TYPE ",CP=" MY_CAPABILITIES ",FQ=%" PRIu16 ",REL=%"
-	                PRIu8 ",VER="
-	                MYSENSORS_LIBRARY_VERSION "\n"), (uint16_t)(F_CPU/1000000UL),
-	           MYSENSORS_LIBRARY_VERSION_PRERELEASE_NUMBER);
+	CORE_DEBUG_TEXT(PSTR("MCO:BGN:INIT " MY_NODE_TYPE ",CP=" MY_CAPABILITIES ",FQ=%" PRIu16 ",REL=%"
+	                     PRIu8 ",VER="
+	                     MYSENSORS_LIBRARY_VERSION "\n"), (uint16_t)(F_CPU/1000000UL),
+	                MYSENSORS_LIBRARY_VERSION_PRERELEASE_NUMBER);
 #else
-	CORE_DEBUG(PSTR("MCO:BGN:INIT " MY_NODE_TYPE ",CP=" MY_CAPABILITIES ",FQ=NA,REL=%"
-	                PRIu8 ",VER="
-	                MYSENSORS_LIBRARY_VERSION "\n"), MYSENSORS_LIBRARY_VERSION_PRERELEASE_NUMBER);
+	CORE_DEBUG_TEXT(PSTR("MCO:BGN:INIT " MY_NODE_TYPE ",CP=" MY_CAPABILITIES ",FQ=NA,REL=%"
+	                     PRIu8 ",VER="
+	                     MYSENSORS_LIBRARY_VERSION "\n"), MYSENSORS_LIBRARY_VERSION_PRERELEASE_NUMBER);
 #endif
 	if (!hwInitResult) {
 		CORE_DEBUG(PSTR("!MCO:BGN:HW ERR\n"));
@@ -488,6 +592,19 @@ bool _processInternalCoreMessage(void)
 			if (debug_msg == 'R') {		// routing table
 #if defined(MY_REPEATER_FEATURE) && defined(MY_SENSOR_NETWORK)
 				transportReportRoutingTable();
+#endif
+			} else if (debug_msg == 'T') {	// routing table export
+#if defined(MY_REPEATER_FEATURE) && defined(MY_SENSOR_NETWORK)
+				transportExportRoutingTable();
+#endif
+			} else if (debug_msg == 'W') {	// routing table import
+#if defined(MY_REPEATER_FEATURE) && defined(MY_SENSOR_NETWORK)
+				uint8_t rejected;
+				const uint8_t imported = transportImportRoutes(&_msg.data[1], _msg.getLength() - 1, &rejected);
+				char reply[8];
+				(void)snprintf_P(reply, sizeof(reply), PSTR("%" PRIu8 ",%" PRIu8), imported, rejected);
+				(void)_sendRoute(build(_msgTmp, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL,
+				                       I_DEBUG).set(reply));
 #endif
 			} else if (debug_msg == 'V') {	// CPU voltage
 				(void)_sendRoute(build(_msgTmp, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL,
@@ -498,6 +615,21 @@ bool _processInternalCoreMessage(void)
 			} else if (debug_msg == 'M') {	// free memory
 				(void)_sendRoute(build(_msgTmp, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL,
 				                       I_DEBUG).set(hwFreeMem()));
+			} else if (debug_msg == 'L') {	// message path latency
+#if defined(MY_DEBUG_LATENCY)
+				latencyPrint();
+				for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+					latencyReport_t report;
+					if (latencyGetReport(static_cast<latencyStage_t>(stage), report)) {
+						uint8_t outBuf[1 + sizeof(report)];
+						outBuf[0] = stage;
+						(void)memcpy(&outBuf[1], &report, sizeof(report));
+						// No pacing, a wait() here would stall the gateway for every stage
+						(void)_sendRoute(build(_msgTmp, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL,
+						                       I_DEBUG).set(outBuf, sizeof(outBuf)));
+					}
+				}
+#endif
 			} else if (debug_msg == 'E') {	// clear MySensors eeprom area and reboot
 				(void)_sendRoute(build(_msgTmp, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_DEBUG).set("OK"));
 				for (uint16_t i = EEPROM_START; i<EEPROM_LOCAL_CONFIG_ADDRESS; i++) {
@@ -562,8 +694,9 @@ void wait(const uint32_t waitingMS)
 	waitLock++;
 #endif
 	const uint32_t enteringMS = hwMillis();
-	while (hwMillis() - enteringMS < waitingMS) {
-		_process();
+	uint32_t elapsedMS;
+	while ((elapsedMS = hwMillis() - enteringMS) < waitingMS) {
+		_process(waitingMS - elapsedMS);
 	}
 #if defined(MY_DEBUG_VERBOSE_CORE)
 	waitLock--;
@@ -583,8 +716,9 @@ bool wait(const uint32_t waitingMS, const mysensors_command_t cmd)
 	//_msg.setCommand(!cmd);
 	_msg.setCommand(C_INVALID_7);
 	bool expectedResponse = false;
-	while ((hwMillis() - enteringMS < waitingMS) && !expectedResponse) {
-		_process();
+	uint32_t elapsedMS;
+	while (((elapsedMS = hwMillis() - enteringMS) < waitingMS) && !expectedResponse) {
+		_process(waitingMS - elapsedMS);
 		expectedResponse = (_msg.getCommand() == cmd);
 	}
 #if defined(MY_DEBUG_VERBOSE_CORE)
@@ -606,8 +740,9 @@ bool wait(const uint32_t waitingMS, const mysensors_command_t cmd, const uint8_t
 	//_msg.setCommand(!cmd);
 	_msg.setCommand(C_INVALID_7);
 	bool expectedResponse = false;
-	while ( (hwMillis() - enteringMS < waitingMS) && !expectedResponse ) {
-		_process();
+	uint32_t elapsedMS;
+	while ( ((elapsedMS = hwMillis() - enteringMS) < waitingMS) && !expectedResponse ) {
+		_process(waitingMS - elapsedMS);
 		expectedResponse = (_msg.getCommand() == cmd && _msg.getType() == msgType);
 	}
 #if defined(MY_DEBUG_VERBOSE_CORE)
@@ -620,6 +755,10 @@ void doYield(void)
 {
 	hwWatchdogReset();
 	yield();
+#if defined(__linux__)
+	// Also leaves blocking loops, e.g. in _begin() or wait()
+	hwShutdownCheck();
+#endif
 #if defined (MY_DEFAULT_TX_LED_PIN) || defined(MY_DEFAULT_RX_LED_PIN) || defined(MY_DEFAULT_ERR_LED_PIN)
 	ledsProcess();
 #endif
@@ -716,6 +855,9 @@ int8_t _sleep(const uint32_t sleepingMS, const bool smartSleep, const uint8_t in
 	}
 #endif
 
+#if defined(MY_DEBUG_TRACE)
+	traceFlush();
+#endif
 	// Call the sleep handler to turn off peripherals optimally
 	sleepHandler(true);
 
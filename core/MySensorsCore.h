@@ -433,8 +433,9 @@ void _checkNodeLock(void);
 void _begin(void);
 /**
 * @brief Main framework process
+* @param maxIdleMS Upper bound for blocking while waiting for events (architectures with event loop)
 */
-void _process(void);
+void _process(const uint32_t maxIdleMS = UINT32_MAX);
 /**
 * @brief Processes internal core message
 * @return True if no further processing required
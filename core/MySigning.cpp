@@ -18,6 +18,9 @@
  */
 
 #include "MySigning.h"
+#if defined(MY_SIGNING_PENDING_ENABLED)
+#include "MyTransport.h"
+#endif
 
 #define SIGNING_PRESENTATION_VERSION_1 1
 #define SIGNING_PRESENTATION_REQUIRE_SIGNATURES   (1 << 0)
@@ -48,6 +51,31 @@ static uint8_t nof_nonce_requests = 0;
 static uint8_t nof_failed_verifications = 0;
 #endif
 
+typedef struct {
+	uint32_t timestamp;	// Time the nonce was sent
+	uint8_t nodeId;		// Node the nonce was sent to
+	bool valid;
+	uint8_t nonce[32];
+} signingNonce_t;
+
+static signingNonce_t _signingNonces[MY_SIGNING_NONCE_CACHE_SIZE];
+
+#if defined(MY_SIGNING_PENDING_ENABLED)
+// State of a message in the pending queue
+enum { SIGN_PENDING_FREE = 0, SIGN_PENDING_QUEUED = 1, SIGN_PENDING_NONCE = 2 };
+
+typedef struct {
+	MyMessage msg;		// Message to sign
+	uint32_t timeMS;	// Time the nonce was requested
+	uint8_t route;		// Next hop the transport chose for the message
+	uint8_t sequence;	// Order of the messages to a destination
+	uint8_t state;
+} signingPending_t;
+
+static signingPending_t _signingPending[MY_SIGNING_PENDING_SIZE];
+static uint8_t _signingPendingSequence = 0;
+#endif
+
 // Status when waiting for signing nonce in signerSignMsg
 enum { SIGN_WAITING_FOR_NONCE = 0, SIGN_OK = 1 };
 
@@ -193,6 +221,84 @@ bool signerCheckTimer(void)
 	return signerBackendCheckTimer();
 }
 
+#if defined(MY_SIGNING_FEATURE)
+static void signerNoncePurge(signingNonce_t *entry)
+{
+	(void)memset((void *)entry->nonce, 0xAA, sizeof(entry->nonce));
+	entry->valid = false;
+}
+
+static bool signerNonceExpired(const signingNonce_t *entry)
+{
+	return hwMillis() - entry->timestamp > MY_VERIFICATION_TIMEOUT_MS;
+}
+#endif
+
+void signerNonceStore(const uint8_t nodeId, const uint8_t *nonce)
+{
+#if defined(MY_SIGNING_FEATURE)
+	signingNonce_t *slot = NULL;
+	for (uint8_t i = 0; i < MY_SIGNING_NONCE_CACHE_SIZE; i++) {
+		signingNonce_t *entry = &_signingNonces[i];
+		if (entry->valid && entry->nodeId == nodeId) {
+			slot = entry;
+			break;
+		}
+		if (slot == NULL || (slot->valid && (!entry->valid ||
+		                                     entry->timestamp - slot->timestamp > UINT32_MAX / 2))) {
+			// free entry, or else the oldest one
+			slot = entry;
+		}
+	}
+	if (slot->valid && slot->nodeId != nodeId) {
+		SIGN_DEBUG(PSTR("!SGN:NCE:DROP,ID=%" PRIu8 "\n"), slot->nodeId); // Cache full, oldest nonce dropped
+	}
+	slot->timestamp = hwMillis();
+	slot->nodeId = nodeId;
+	slot->valid = true;
+	(void)memcpy((void *)slot->nonce, (const void *)nonce, sizeof(slot->nonce));
+#else
+	(void)nodeId;
+	(void)nonce;
+#endif
+}
+
+bool signerNonceTake(const uint8_t nodeId, uint8_t *nonce)
+{
+#if defined(MY_SIGNING_FEATURE)
+	for (uint8_t i = 0; i < MY_SIGNING_NONCE_CACHE_SIZE; i++) {
+		signingNonce_t *entry = &_signingNonces[i];
+		if (entry->valid && entry->nodeId == nodeId) {
+			const bool expired = signerNonceExpired(entry);
+			if (expired) {
+				SIGN_DEBUG(PSTR("!SGN:NCE:TMR,ID=%" PRIu8 "\n"), nodeId); // Nonce expired
+			} else {
+				(void)memcpy((void *)nonce, (const void *)entry->nonce, sizeof(entry->nonce));
+			}
+			signerNoncePurge(entry);
+			return !expired;
+		}
+	}
+#else
+	(void)nodeId;
+	(void)nonce;
+#endif
+	return false;
+}
+
+void signerNonceExpire(void)
+{
+#if defined(MY_SIGNING_FEATURE)
+	for (uint8_t i = 0; i < MY_SIGNING_NONCE_CACHE_SIZE; i++) {
+		signingNonce_t *entry = &_signingNonces[i];
+		if (entry->valid && signerNonceExpired(entry)) {
+			SIGN_DEBUG(PSTR("!SGN:NCE:TMR,ID=%" PRIu8 "\n"), entry->nodeId); // Nonce expired
+			signerNoncePurge(entry);
+		}
+	}
+#endif
+}
+
 // cppcheck-suppress constParameter
 bool signerSignMsg(MyMessage &msg)
 {
@@ -221,10 +327,11 @@ bool signerSignMsg(MyMessage &msg)
 					// We have to wait for the nonce to arrive before we can sign our original message
 					// Other messages could come in-between. We trust _process() takes care of them
 					unsigned long enter = hwMillis();
+					unsigned long elapsed;
 					_msgSign = msg; // Copy the message to sign since buffer might be touched in _process()
-					while (hwMillis() - enter < MY_VERIFICATION_TIMEOUT_MS &&
+					while ((elapsed = hwMillis() - enter) < MY_VERIFICATION_TIMEOUT_MS &&
 					        _signingNonceStatus==SIGN_WAITING_FOR_NONCE) {
-						_process();
+						_process(MY_VERIFICATION_TIMEOUT_MS - elapsed);
 					}
 					if (hwMillis() - enter > MY_VERIFICATION_TIMEOUT_MS) {
 						SIGN_DEBUG(PSTR("!SGN:SGN:NCE TMO\n")); // Timeout waiting for nonce!
@@ -264,6 +371,149 @@ bool signerSignMsg(MyMessage &msg)
 
 }
 
+#if defined(MY_SIGNING_PENDING_ENABLED)
+// Oldest queued message to destination in state
+static signingPending_t *signerPendingFind(const uint8_t destination, const uint8_t state)
+{
+	signingPending_t *found = NULL;
+	for (uint8_t i = 0; i < MY_SIGNING_PENDING_SIZE; i++) {
+		signingPending_t *entry = &_signingPending[i];
+		if (entry->state == state && entry->msg.getDestination() == destination &&
+		        (found == NULL || (int8_t)(entry->sequence - found->sequence) < 0)) {
+			found = entry;
+		}
+	}
+	return found;
+}
+
+static void signerPendingNext(const uint8_t destination);
+
+static void signerPendingFailed(void)
+{
+	setIndication(INDICATION_ERR_SIGN);
+#if defined(MY_LINUX_METRICS)
+	metricsSignFailed();
+#endif
+}
+
+// Free entry and move on to the next message to the same destination before reporting the
+// result, so messages sent from the callback queue up behind it
+static void signerPendingComplete(signingPending_t *entry, const bool success)
+{
+	const MyMessage msg = entry->msg;
+	entry->state = SIGN_PENDING_FREE;
+	signerPendingNext(msg.getDestination());
+	if (signedSendComplete) {
+		signedSendComplete(msg, success);
+	}
+}
+
+static bool signerPendingRequestNonce(signingPending_t *entry)
+{
+	const uint8_t destination = entry->msg.getDestination();
+	entry->state = SIGN_PENDING_NONCE;
+	entry->timeMS = hwMillis();
+	if (!_sendRoute(build(_msgSign, destination, entry->msg.getSensor(), C_INTERNAL,
+	                      I_NONCE_REQUEST).set(""))) {
+		SIGN_DEBUG(PSTR("!SGN:SGN:NCE REQ,TO=%" PRIu8 " FAIL\n"),
+		           destination); // Failed to transmit nonce request!
+		return false;
+	}
+	SIGN_DEBUG(PSTR("SGN:SGN:NCE REQ,TO=%" PRIu8 "\n"), destination); // Nonce requested
+	return true;
+}
+
+// Request the nonce for the next message to destination, unless one is requested already
+static void signerPendingNext(const uint8_t destination)
+{
+	if (signerPendingFind(destination, SIGN_PENDING_NONCE) != NULL) {
+		return;
+	}
+	signingPending_t *entry = signerPendingFind(destination, SIGN_PENDING_QUEUED);
+	if (entry != NULL && !signerPendingRequestNonce(entry)) {
+		signerPendingFailed();
+		signerPendingComplete(entry, false);
+	}
+}
+
+static signerQueueResult_t signerPendingAdd(MyMessage &msg, const uint8_t route)
+{
+	signingPending_t *entry = NULL;
+	for (uint8_t i = 0; entry == NULL && i < MY_SIGNING_PENDING_SIZE; i++) {
+		if (_signingPending[i].state == SIGN_PENDING_FREE) {
+			entry = &_signingPending[i];
+		}
+	}
+	if (entry == NULL) {
+		SIGN_DEBUG(PSTR("!SGN:SGN:QUE FULL\n")); // No room to wait for another nonce
+		return SIGNER_QUEUE_FAILED;
+	}
+	entry->msg = msg;
+	entry->route = route;
+	entry->sequence = _signingPendingSequence++;
+	if (signerPendingFind(msg.getDestination(), SIGN_PENDING_NONCE) != NULL) {
+		// Nonce of the destination is requested for an earlier message, wait for the next one
+		entry->state = SIGN_PENDING_QUEUED;
+		SIGN_DEBUG(PSTR("SGN:SGN:QUE,TO=%" PRIu8 "\n"), msg.getDestination());
+		return SIGNER_QUEUE_PENDING;
+	}
+	if (!signerPendingRequestNonce(entry)) {
+		entry->state = SIGN_PENDING_FREE;
+		return SIGNER_QUEUE_FAILED;
+	}
+	return SIGNER_QUEUE_PENDING;
+}
+
+// Sign and send the message waiting for the nonce in msg
+static void signerPendingProcessNonce(MyMessage &msg)
+{
+	signingPending_t *entry = signerPendingFind(msg.getSender(), SIGN_PENDING_NONCE);
+	if (entry == NULL) {
+		SIGN_DEBUG(PSTR("SGN:NCE:NREQ (DROPPED)\n")); // No message waits for a nonce from the sender
+		return;
+	}
+	signerBackendPutNonce(msg);
+	if (signerBackendSignMsg(entry->msg)) {
+		SIGN_DEBUG(PSTR("SGN:SGN:SGN\n")); // Message to send has been signed
+		signerPendingComplete(entry, transportSendQueued(entry->route, entry->msg));
+	} else {
+		SIGN_DEBUG(PSTR("!SGN:SGN:SGN FAIL\n")); // Message to send could not be signed!
+		signerPendingFailed();
+		signerPendingComplete(entry, false);
+	}
+}
+#endif
+
+signerQueueResult_t signerQueueMsg(MyMessage &msg, const uint8_t route)
+{
+#if defined(MY_SIGNING_PENDING_ENABLED)
+	if (DO_SIGN(msg.getDestination()) && msg.getSender() == getNodeId() && stateValid) {
+		return skipSign(msg) ? SIGNER_QUEUE_SEND : signerPendingAdd(msg, route);
+	}
+#else
+	(void)route;
+#endif
+	return signerSignMsg(msg) ? SIGNER_QUEUE_SEND : SIGNER_QUEUE_FAILED;
+}
+
+void signerProcessPending(void)
+{
+	// Purge nonces that timed out, also when no message arrives
+	(void)signerCheckTimer();
+#if defined(MY_SIGNING_PENDING_ENABLED)
+	for (uint8_t i = 0; i < MY_SIGNING_PENDING_SIZE; i++) {
+		signingPending_t *entry = &_signingPending[i];
+		if (entry->state == SIGN_PENDING_NONCE &&
+		        hwMillis() - entry->timeMS > MY_VERIFICATION_TIMEOUT_MS) {
+			SIGN_DEBUG(PSTR("!SGN:SGN:NCE TMO,TO=%" PRIu8 "\n"),
+			           entry->msg.getDestination()); // Timeout waiting for nonce!
+			signerPendingFailed();
+			signerPendingComplete(entry, false);
+		}
+	}
+#endif
+}
+
 // cppcheck-suppress constParameter
 bool signerVerifyMsg(MyMessage &msg)
 {
@@ -548,6 +798,9 @@ static bool signerInternalProcessNonceResponse(MyMessage &msg)
 #if defined(MY_SIGNING_FEATURE)
 	// Proceed with signing if nonce has been received
 	SIGN_DEBUG(PSTR("SGN:NCE:FROM=%" PRIu8 "\n"), msg.getSender());
+#if defined(MY_SIGNING_PENDING_ENABLED)
+	signerPendingProcessNonce(msg);
+#else
 	if (msg.getSender() != _msgSign.getDestination()) {
 		SIGN_DEBUG(PSTR("SGN:NCE:%" PRIu8 "!=%" PRIu8 " (DROPPED)\n"), _msgSign.getDestination(),
 		           msg.getSender());
@@ -558,6 +811,7 @@ static bool signerInternalProcessNonceResponse(MyMessage &msg)
 			_signingNonceStatus = SIGN_OK;
 		}
 	}
+#endif
 #else
 	(void)msg;
 	SIGN_DEBUG(
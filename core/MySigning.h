@@ -612,6 +612,19 @@ typedef struct {
 /** @brief Helper macro to determine the number of elements in a array */
 #define NUM_OF(x) (sizeof(x)/sizeof(x[0]))
 
+#if defined(MY_SIGNING_FEATURE) && defined(MY_SENSOR_NETWORK) && (MY_SIGNING_PENDING_SIZE > 0)
+#define MY_SIGNING_PENDING_ENABLED	//!< Messages to sign wait for their nonce in a queue
+#endif
+
+/**
+ * @brief Result of @ref signerQueueMsg()
+ */
+typedef enum {
+	SIGNER_QUEUE_SEND,		//!< Send the message now, it is signed or needs no signature
+	SIGNER_QUEUE_PENDING,	//!< The message waits for a nonce and is sent to its route when it arrives
+	SIGNER_QUEUE_FAILED		//!< The message cannot be signed
+} signerQueueResult_t;
+
 /**
  * @brief Initializes signing infrastructure and associated backend.
  *
@@ -661,6 +674,36 @@ bool signerProcessInternal(MyMessage &msg);
  */
 bool signerCheckTimer(void);
 
+/**
+ * @brief Stores a nonce sent to a node for the verification of its next signed message.
+ *
+ * Each node has its own entry, so nonce requests of several nodes do not overwrite each other.
+ * A new nonce replaces a previous one of the same node. If all @ref MY_SIGNING_NONCE_CACHE_SIZE
+ * entries are in use, the oldest nonce is dropped.
+ * \n@b Usage: This function is called by the signing backend when a nonce is generated.
+ *
+ * @param nodeId Node the nonce is sent to.
+ * @param nonce 32 byte nonce.
+ */
+void signerNonceStore(const uint8_t nodeId, const uint8_t *nonce);
+
+/**
+ * @brief Fetches and purges the nonce sent to a node.
+ *
+ * \n@b Usage: This function is called by the signing backend to verify a signed message.
+ *
+ * @param nodeId Node the nonce was sent to.
+ * @param nonce Buffer for the 32 byte nonce.
+ * @returns @c true if a nonce was sent to the node within @ref MY_VERIFICATION_TIMEOUT_MS.
+ */
+bool signerNonceTake(const uint8_t nodeId, uint8_t *nonce);
+
+/**
+ * @brief Purges nonces older than @ref MY_VERIFICATION_TIMEOUT_MS.
+ * \n@b Usage: This function is called by @ref signerCheckTimer().
+ */
+void signerNonceExpire(void);
+
 /**
  * @brief Get nonce from provided message and store for signing operations.
  *
@@ -694,6 +737,38 @@ bool signerPutNonce(MyMessage &msg);
 */
 bool signerSignMsg(MyMessage &msg);
 
+/**
+ * @brief Signs provided message, or queues it until the nonce of the destination arrives.
+ *
+ * With @ref MY_SIGNING_PENDING_SIZE entries the nonce is requested and the call returns, the message
+ * is signed and handed to @ref transportSendQueued() for route when the nonce response is processed.
+ * Only one nonce request per destination is outstanding, further messages to the same destination
+ * wait for their turn. The result of the transmission is passed to @ref signedSendComplete().
+ * Without entries this is @ref signerSignMsg().
+ * \n@b Usage: This function is called by the transport for every message before it is sent.
+ *
+ * @param msg The message to sign.
+ * @param route Next hop of the message, used when it is sent from the queue.
+ * @returns @ref SIGNER_QUEUE_SEND if msg is to be sent now, @ref SIGNER_QUEUE_PENDING if msg
+ *          was queued, @ref SIGNER_QUEUE_FAILED if msg cannot be signed or queued.
+ */
+signerQueueResult_t signerQueueMsg(MyMessage &msg, const uint8_t route);
+
+/**
+ * @brief Fails queued messages whose nonce did not arrive within @ref MY_VERIFICATION_TIMEOUT_MS
+ * and purges nonces sent to nodes that did not use them in time.
+ * \n@b Usage: This function should be called on regular intervals, typically within some process loop.
+ */
+void signerProcessPending(void);
+
+/**
+ * @brief Callback for the result of a message that waited for a nonce (see @ref signerQueueMsg()).
+ *
+ * @param message The message, signed if the nonce arrived.
+ * @param success @c true if the message was signed and sent.
+ */
+void signedSendComplete(const MyMessage &message, const bool success) __attribute__((weak));
+
 /**
  * @brief Verifies signature in provided message.
  *
@@ -807,7 +882,7 @@ int signerMemcmp(const void* a, const void* b, size_t sz);
  * |!| SGN | BND | SIG,SIZE,'message'>'max'	| Refusing to sign 'message' because it is bigger than 'max' allowed size
  * | | SGN | BND | SIG WHI,ID='id'					| Salting message with our 'id'
  * | | SGN | BND | SIG WHI,SERIAL='serial'	| Salting message with our 'serial'
- * |!| SGN | BND | VER ONGOING							| Verification failed, no ongoing session
+ * |!| SGN | BND | VER NONCE,ID='sender'	| Verification failed, no unexpired nonce was sent to 'sender'
  * |!| SGN | BND | VER,IDENT='identifier'		| Verification failed, 'identifier' is unknown
  * | | SGN | BND | VER WHI,ID='sender'			| 'sender' found in whitelist
  * | | SGN | BND | VER WHI,SERIAL='serial'	| Expecting 'serial' for this sender
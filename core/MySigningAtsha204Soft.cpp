@@ -40,8 +40,6 @@
 #define SIGN_DEBUG(x,...)
 #endif
 
-static unsigned long _signing_timestamp;
-static bool _signing_verification_ongoing = false;
 static bool _signing_init_ok = false;
 static uint8_t _signing_verifying_nonce[32+9+1];
 static uint8_t _signing_nonce[32+9+1];
@@ -103,24 +101,8 @@ bool signerAtsha204SoftCheckTimer(void)
 	if (!_signing_init_ok) {
 		return false;
 	}
-	if (_signing_verification_ongoing) {
-		unsigned long time_now = hwMillis();
-		// If timestamp is taken so late a rollover can take place during the timeout,
-		// offset both timestamp and current time to make sure no rollover takes place during the
-		// timeout
-		if (_signing_timestamp + MY_VERIFICATION_TIMEOUT_MS < _signing_timestamp) {
-			_signing_timestamp += MY_VERIFICATION_TIMEOUT_MS;
-			time_now += MY_VERIFICATION_TIMEOUT_MS;
-		}
-		if (time_now > _signing_timestamp + MY_VERIFICATION_TIMEOUT_MS) {
-			SIGN_DEBUG(PSTR("!SGN:BND:TMR\n")); //Verification timeout
-			// Purge nonce
-			(void)memset((void *)_signing_nonce, 0xAA, sizeof(_signing_nonce));
-			(void)memset((void *)_signing_verifying_nonce, 0xAA, sizeof(_signing_verifying_nonce));
-			_signing_verification_ongoing = false;
-			return false;
-		}
-	}
+	// Purge nonces of nodes that did not send a signed message in time
+	signerNonceExpire();
 	return true;
 }
 
@@ -148,16 +130,12 @@ bool signerAtsha204SoftGetNonce(MyMessage &msg)
 		(void)memset((void *)&_signing_verifying_nonce[MAX_PAYLOAD_SIZE], 0xAA, 32u - MAX_PAYLOAD_SIZE);
 	}
 
+	// Keep the nonce for the verification of the requesting node's message
+	signerNonceStore(msg.getSender(), _signing_verifying_nonce);
 	// Transfer the first part of the nonce to the message
 	msg.set(_signing_verifying_nonce, MIN((uint8_t)MAX_PAYLOAD_SIZE, (uint8_t)32));
-	_signing_verification_ongoing = true;
-	_signing_timestamp = hwMillis(); // Set timestamp to determine when to purge nonce
-	// Be a little fancy to handle turnover (prolong the time allowed to timeout after turnover)
-	// Note that if message is "too" quick, and arrives before turnover, it will be rejected
-	// but this is consider such a rare case that it is accepted and rejects are 'safe'
-	if (_signing_timestamp + MY_VERIFICATION_TIMEOUT_MS < hwMillis()) {
-		_signing_timestamp = 0;
-	}
+	// The cache holds the nonce until it is used or expires, purge the working copy
+	(void)memset((void *)_signing_verifying_nonce, 0xAA, sizeof(_signing_verifying_nonce));
 	return true;
 }
 
@@ -215,23 +193,20 @@ bool signerAtsha204SoftSignMsg(MyMessage &msg)
 
 bool signerAtsha204SoftVerifyMsg(MyMessage &msg)
 {
-	if (!_signing_verification_ongoing) {
-		SIGN_DEBUG(PSTR("!SGN:BND:VER ONGOING\n"));
+	// Fetch the unexpired nonce sent to the sender
+	if (!signerNonceTake(msg.getSender(), _signing_verifying_nonce)) {
+		SIGN_DEBUG(PSTR("!SGN:BND:VER NONCE,ID=%" PRIu8 "\n"), msg.getSender());
 		return false;
 	} else {
-		// Make sure we have not expired
-		if (!signerCheckTimer()) {
-			return false;
-		}
-
-		_signing_verification_ongoing = false;
-
 		if (msg.data[msg.getLength()] != SIGNING_IDENTIFIER) {
 			SIGN_DEBUG(PSTR("!SGN:BND:VER,IDENT=%" PRIu8 "\n"), msg.data[msg.getLength()]);
+			(void)memset((void *)_signing_verifying_nonce, 0xAA, sizeof(_signing_verifying_nonce));
 			return false;
 		}
 
 		signerCalculateSignature(msg, false); // Get signature of message
+		// Purge nonce, it is used once
+		(void)memset((void *)_signing_verifying_nonce, 0xAA, sizeof(_signing_verifying_nonce));
 
 #ifdef MY_SIGNING_NODE_WHITELISTING
 		// Look up the senders nodeId in our whitelist and salt the signature with that data
@@ -0,0 +1,202 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "MyTrace.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <pthread.h>
+#endif
+
+#if MY_DEBUG_TRACE_BUFFER_SIZE < MY_SERIAL_OUTPUT_SIZE
+#error MY_DEBUG_TRACE_BUFFER_SIZE must be at least MY_SERIAL_OUTPUT_SIZE
+#endif
+
+#define TRACE_FNV_OFFSET (2166136261ul)	//!< FNV-1a offset basis
+#define TRACE_FNV_PRIME (16777619ul)	//!< FNV-1a prime
+#define TRACE_VARINT_MAX ((sizeof(unsigned long) * 8 + 6) / 7)	//!< Longest varint
+
+static uint8_t _traceBuffer[MY_DEBUG_TRACE_BUFFER_SIZE];
+static size_t _traceLength = 0;
+static uint32_t _traceLastMS = 0;
+#if defined(__linux__)
+// The threaded gateway logs from its own thread as well
+static pthread_mutex_t _traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static int _traceFd = -1;
+#endif
+
+static uint8_t *_traceVarint(uint8_t *pos, unsigned long value)
+{
+	while (value >= 0x80u) {
+		*pos++ = (uint8_t)(value | 0x80u);
+		value >>= 7;
+	}
+	*pos++ = (uint8_t)value;
+	return pos;
+}
+
+static unsigned long _traceZigZag(const long value)
+{
+	return ((unsigned long)value << 1) ^ (unsigned long)(value >> (sizeof(long) * 8 - 1));
+}
+
+static void _traceFlush(void)
+{
+	if (_traceLength == 0) {
+		return;
+	}
+#if defined(__linux__)
+	if (_traceFd == -1) {
+		_traceFd = open(MY_LINUX_TRACE_FILE, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (_traceFd == -1) {
+			logError("Failed to open trace file %s: %s\n", MY_LINUX_TRACE_FILE, strerror(errno));
+			_traceFd = -2;
+		}
+	}
+	if (_traceFd >= 0 && write(_traceFd, _traceBuffer, _traceLength) < 0) {
+		logError("Failed to write trace file: %s\n", strerror(errno));
+	}
+#else
+	(void)MY_DEBUGDEVICE.write(_traceBuffer, _traceLength);
+#endif
+	_traceLength = 0;
+}
+
+void traceEvent(const char *fmt, ...)
+{
+	uint8_t record[MY_SERIAL_OUTPUT_SIZE];
+	// Leave room for up to three varints of one conversion, e.g. %*.*d
+	const uint8_t *end = record + sizeof(record) - 3 * TRACE_VARINT_MAX;
+	uint32_t hash = TRACE_FNV_OFFSET;
+	bool overflow = false;
+	va_list args;
+
+#if defined(__linux__)
+	pthread_mutex_lock(&_traceMutex);
+#endif
+	const uint32_t now = hwMillis();
+	uint8_t *pos = _traceVarint(record + 5, now - _traceLastMS);
+
+	va_start(args, fmt);
+	for (char c; (c = pgm_read_byte(fmt)) != '\0'; ) {
+		fmt++;
+		hash = (hash ^ (uint8_t)c) * TRACE_FNV_PRIME;
+		if (c != '%') {
+			continue;
+		}
+		if (pos > end) {
+			overflow = true;
+			break;
+		}
+		// flags, width and precision are part of the id, length modifiers are not
+		uint8_t longs = 0;
+		while ((c = pgm_read_byte(fmt)) != '\0') {
+			fmt++;
+			if (c == 'l') {
+				longs++;
+				continue;
+			}
+			if (c == 'h' || c == 'z' || c == 'j' || c == 't' || c == 'L' || c == 'q') {
+				continue;
+			}
+			hash = (hash ^ (uint8_t)c) * TRACE_FNV_PRIME;
+			if (c == '*') {
+				pos = _traceVarint(pos, _traceZigZag(va_arg(args, int)));
+			} else if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == ' ' || c == '#' ||
+			             c == '.')) {
+				break;
+			}
+		}
+		if (c == 'd' || c == 'i') {
+			long value;
+			if (longs > 1) {
+				value = (long)va_arg(args, long long);
+			} else if (longs) {
+				value = va_arg(args, long);
+			} else {
+				value = va_arg(args, int);
+			}
+			pos = _traceVarint(pos, _traceZigZag(value));
+		} else if (c == 's') {
+			const char *str = va_arg(args, const char *);
+			size_t length = str != NULL ? strlen(str) : 0;
+			const size_t space = end + 3 * TRACE_VARINT_MAX - pos - 2;
+			if (length > space) {
+				length = space;
+			}
+			pos = _traceVarint(pos, length);
+			memcpy(pos, str, length);
+			pos += length;
+		} else if (c == 'p') {
+			pos = _traceVarint(pos, (unsigned long)(uintptr_t)va_arg(args, void *));
+		} else if (c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G') {
+			// float bits
+			union {
+				float f;
+				uint32_t u;
+			} value;
+			value.f = (float)va_arg(args, double);
+			pos = _traceVarint(pos, value.u);
+		} else if (c == '%') {
+			// literal
+		} else if (c != '\0') {
+			unsigned long value;
+			if (longs > 1) {
+				value = (unsigned long)va_arg(args, unsigned long long);
+			} else if (longs) {
+				value = va_arg(args, unsigned long);
+			} else {
+				value = va_arg(args, unsigned int);
+			}
+			pos = _traceVarint(pos, value);
+		} else {
+			break;
+		}
+	}
+	va_end(args);
+
+	if (!overflow) {
+		record[0] = TRACE_RECORD_START;
+		record[1] = (uint8_t)hash;
+		record[2] = (uint8_t)(hash >> 8);
+		record[3] = (uint8_t)(hash >> 16);
+		record[4] = (uint8_t)(hash >> 24);
+		const size_t length = pos - record;
+		if (_traceLength + length > sizeof(_traceBuffer)) {
+			_traceFlush();
+		}
+		(void)memcpy(&_traceBuffer[_traceLength], record, length);
+		_traceLength += length;
+		_traceLastMS = now;
+	}
+#if defined(__linux__)
+	pthread_mutex_unlock(&_traceMutex);
+#endif
+}
+
+void traceFlush(void)
+{
+#if defined(__linux__)
+	pthread_mutex_lock(&_traceMutex);
+#endif
+	_traceFlush();
+#if defined(__linux__)
+	pthread_mutex_unlock(&_traceMutex);
+#endif
+}
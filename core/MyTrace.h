@@ -0,0 +1,69 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+/**
+ * @file MyTrace.h
+ *
+ * @brief API declaration for MyTrace
+ * @defgroup MyTracegrp MyTrace
+ * @ingroup internals
+ * @{
+ *
+ * @brief Binary debug trace, enabled by MY_DEBUG_TRACE.
+ *
+ * Each debug print is written as a record instead of formatted text:
+ *
+ * | Field    | Size     | Content
+ * |----------|----------|--------------------------------------------------------
+ * | start    | 1 byte   | @ref TRACE_RECORD_START
+ * | id       | 4 bytes  | FNV-1a hash of the format string, little endian
+ * | time     | varint   | hwMillis() since the previous record
+ * | args     | varint   | one per conversion: unsigned values as is, signed values zigzag encoded,
+ * |          |          | strings as length followed by the characters
+ *
+ * Length modifiers (l, h, z...) are left out of the hash, so PRIu32 etc. give the same id on
+ * every architecture. Varints are 7 bits per byte, least significant first, bit 7 set on all but
+ * the last byte. Logparser/tracedecode.py finds the format strings in the sources and decodes
+ * the records.
+ */
+#ifndef MyTrace_h
+#define MyTrace_h
+
+#if defined(MY_GATEWAY_SERIAL) && !defined(MY_DEBUGDEVICE) && !defined(__linux__)
+#error MY_DEBUG_TRACE would corrupt the serial gateway protocol, define MY_DEBUGDEVICE to another serial port
+#endif
+
+#define TRACE_RECORD_START (0xFEu) //!< First byte of a trace record, never part of ASCII text
+
+/**
+ * @brief Queue a binary trace record of a debug print
+ *
+ * @param fmt printf format string (in PROGMEM)
+ * @param ... arguments
+ */
+void traceEvent(const char *fmt, ...);
+
+/**
+ * @brief Write the queued trace records to the debug device
+ */
+void traceFlush(void);
+
+#endif /* MyTrace_h */
+
+/** @}*/
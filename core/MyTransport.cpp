@@ -56,8 +56,27 @@ extern MyMessage _msgTmp;	// outgoing message
 
 #if defined(MY_RAM_ROUTING_TABLE_ENABLED)
 static routingTable_t _transportRoutingTable;		//!< routing table
+#elif defined(MY_RAM_ROUTING_CACHE_ENABLED)
+static routingCacheEntry_t _transportRoutingCache[MY_RAM_ROUTING_CACHE_SIZE];	//!< recently used routes
+static uint8_t _transportRoutingCacheHand;		//!< next replacement candidate
+#endif
+#if defined(MY_RAM_ROUTING_TABLE_ENABLED) || defined(MY_RAM_ROUTING_CACHE_ENABLED)
 static uint32_t _lastRoutingTableSave;			//!< last routing table dump
 #endif
+static uint32_t _transportRoutingTableWrites;	//!< routing table bytes written to EEPROM
+
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+static routingAlternate_t _transportAlternates[MY_ROUTING_ALTERNATES_SIZE];	//!< alternate routes
+static routingNeighbour_t _transportNeighbours[MY_ROUTING_NEIGHBOURS_SIZE];	//!< neighbour link quality
+static void transportNeighbourReceived(const uint8_t node, const int16_t RSSI);
+static void transportNeighbourSent(const uint8_t node, const bool delivered);
+static bool transportRouteFailover(const uint8_t destination, const uint8_t route,
+                                   MyMessage &message);
+#endif
+
+#if defined(MY_REPEATER_FEATURE)
+static otaRelayImage_t _transportOTARelay[OTA_RELAY_IMAGES];	//!< FW images requested by children
+#endif
 
 // regular sanity check, activated by default on GW and repeater nodes
 #if defined(MY_TRANSPORT_SANITY_CHECK)
@@ -85,7 +104,7 @@ void stInitTransition(void)
 #if defined(MY_GATEWAY_FEATURE)
 	_lastNetworkDiscovery = 0;
 #endif
-#if defined(MY_RAM_ROUTING_TABLE_ENABLED)
+#if defined(MY_RAM_ROUTING_TABLE_ENABLED) || defined(MY_RAM_ROUTING_CACHE_ENABLED)
 	_lastRoutingTableSave = hwMillis();
 #endif
 
@@ -326,7 +345,7 @@ void stReadyUpdate(void)
 	}
 #endif
 
-#if defined(MY_RAM_ROUTING_TABLE_ENABLED)
+#if defined(MY_RAM_ROUTING_TABLE_ENABLED) || defined(MY_RAM_ROUTING_CACHE_ENABLED)
 	if (hwMillis() - _lastRoutingTableSave > MY_ROUTING_TABLE_SAVE_INTERVAL_MS) {
 		_lastRoutingTableSave = hwMillis();
 		transportSaveRoutingTable();
@@ -379,6 +398,46 @@ uint32_t transportTimeInState(void)
 	return hwMillis() - _transportSM.stateEnter;
 }
 
+// ms until a timer started at startMS expires, timers fire when the interval is exceeded
+static uint32_t transportTimeToExpiry(const uint32_t startMS, const uint32_t intervalMS)
+{
+	const uint32_t elapsedMS = hwMillis() - startMS;
+	return elapsedMS > intervalMS ? 0 : intervalMS - elapsedMS + 1;
+}
+
+uint32_t transportTimeToNextEvent(void)
+{
+	uint32_t result;
+	if (_transportSM.currentState == &stFailure) {
+		result = transportTimeToExpiry(_transportSM.stateEnter, isTransportExtendedFailure() ?
+		                               MY_TRANSPORT_TIMEOUT_EXT_FAILURE_STATE_MS :
+		                               MY_TRANSPORT_TIMEOUT_FAILURE_STATE_MS);
+	} else if (_transportSM.currentState != &stReady) {
+		result = transportTimeToExpiry(_transportSM.stateEnter, MY_TRANSPORT_STATE_TIMEOUT_MS);
+	} else {
+		result = UINT32_MAX;
+#if defined(MY_GATEWAY_FEATURE)
+		result = !_lastNetworkDiscovery ? 0 : min(result, transportTimeToExpiry(_lastNetworkDiscovery,
+		         MY_TRANSPORT_DISCOVERY_INTERVAL_MS));
+#endif
+#if defined(MY_RAM_ROUTING_TABLE_ENABLED) || defined(MY_RAM_ROUTING_CACHE_ENABLED)
+		result = min(result, transportTimeToExpiry(_lastRoutingTableSave,
+		             MY_ROUTING_TABLE_SAVE_INTERVAL_MS));
+#endif
+	}
+	if (_transportSM.transportActive) {
+#if defined(MY_TRANSPORT_SANITY_CHECK)
+		result = min(result, transportTimeToExpiry(_lastSanityCheck,
+		             MY_TRANSPORT_SANITY_CHECK_INTERVAL_MS));
+#endif
+		if (transportHALDataAvailable()) {
+			// FIFO not drained yet
+			result = 0;
+		}
+	}
+	return result;
+}
+
 void transportUpdateSM(void)
 {
 	if (_transportSM.currentState) {
@@ -509,6 +568,45 @@ bool transportAssignNodeID(const uint8_t newNodeId)
 	}
 }
 
+// Failover and accounting once the result of a message is known
+static bool transportRouteComplete(const uint8_t route, MyMessage &message, bool result)
+{
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+	const uint8_t destination = message.getDestination();
+	if (!result && destination != GATEWAY_ADDRESS && destination != BROADCAST_ADDRESS) {
+		result = transportRouteFailover(destination, route, message);
+	}
+#else
+	(void)message;
+#endif
+#if !defined(MY_GATEWAY_FEATURE)
+	// update counter
+	if (route == _transportConfig.parentNodeId) {
+
+		if (!result) {
+			setIndication(INDICATION_ERR_TX);
+			_transportSM.failedUplinkTransmissions++;
+		} else {
+			_transportSM.failedUplinkTransmissions = 0u;
+#if defined(MY_SIGNAL_REPORT_ENABLED)
+			// update uplink quality monitor
+			const int16_t signalStrengthRSSI = transportGetSignalReport(SR_TX_RSSI);
+			_transportSM.uplinkQualityRSSI = static_cast<transportRSSI_t>((1 - UPLINK_QUALITY_WEIGHT) *
+			                                 _transportSM.uplinkQualityRSSI
+			                                 + (UPLINK_QUALITY_WEIGHT * transportRSSItoInternal(signalStrengthRSSI)));
+#endif
+		}
+	}
+#else
+	(void)route;
+	if(!result) {
+		setIndication(INDICATION_ERR_TX);
+	}
+#endif
+
+	return result;
+}
+
 bool transportRouteMessage(MyMessage &message)
 {
 	const uint8_t destination = message.getDestination();
@@ -547,7 +645,7 @@ bool transportRouteMessage(MyMessage &message)
 #else
 		if (destination > GATEWAY_ADDRESS && destination < BROADCAST_ADDRESS) {
 			// node2node traffic: assume node is in vincinity. If transmission fails, hand over to parent
-			if (transportSendWrite(destination, message)) {
+			if (transportSendWrite(destination, message) != TRANSPORT_SEND_FAILED) {
 				TRANSPORT_DEBUG(PSTR("TSF:RTE:N2N OK\n"));
 				return true;
 			}
@@ -556,44 +654,25 @@ bool transportRouteMessage(MyMessage &message)
 		route = _transportConfig.parentNodeId;	// not a repeater, all traffic routed via parent
 #endif
 	}
-	// send message
-	const bool result = transportSendWrite(route, message);
-#if !defined(MY_GATEWAY_FEATURE)
-	// update counter
-	if (route == _transportConfig.parentNodeId) {
-
-		if (!result) {
-			setIndication(INDICATION_ERR_TX);
-			_transportSM.failedUplinkTransmissions++;
-		} else {
-			_transportSM.failedUplinkTransmissions = 0u;
-#if defined(MY_SIGNAL_REPORT_ENABLED)
-			// update uplink quality monitor
-			const int16_t signalStrengthRSSI = transportGetSignalReport(SR_TX_RSSI);
-			_transportSM.uplinkQualityRSSI = static_cast<transportRSSI_t>((1 - UPLINK_QUALITY_WEIGHT) *
-			                                 _transportSM.uplinkQualityRSSI
-			                                 + (UPLINK_QUALITY_WEIGHT * transportRSSItoInternal(signalStrengthRSSI)));
-#endif
-		}
-	}
-#else
-	if(!result) {
-		setIndication(INDICATION_ERR_TX);
+	// send message, a message waiting for a nonce is completed by transportSendQueued()
+	const transportSendResult_t result = transportSendWrite(route, message);
+	if (result == TRANSPORT_SEND_PENDING) {
+		return true;
 	}
-#endif
-
-	return result;
+	return transportRouteComplete(route, message, result == TRANSPORT_SEND_OK);
 }
 
 bool transportSendRoute(MyMessage &message)
 {
 	bool result = false;
+	LATENCY_BEGIN(LATENCY_PATH_TX);
 	if (isTransportReady()) {
 		result = transportRouteMessage(message);
 	} else {
 		// TNR: transport not ready
 		TRANSPORT_DEBUG(PSTR("!TSF:SND:TNR\n"));
 	}
+	LATENCY_END(LATENCY_PATH_TX);
 	return result;
 }
 
@@ -642,6 +721,49 @@ uint32_t transportGetHeartbeat(void)
 	return transportTimeInState();
 }
 
+#if defined(MY_REPEATER_FEATURE)
+// Remember the FW image a child requests, broadcast blocks of it are relayed for a while
+static void transportOTARelayRequest(const MyMessage &message)
+{
+	if (message.getLength() < sizeof(_transportOTARelay[0].image)) {
+		return;
+	}
+	otaRelayImage_t *slot = &_transportOTARelay[0];
+	for (uint8_t i = 0; i < OTA_RELAY_IMAGES; i++) {
+		otaRelayImage_t *entry = &_transportOTARelay[i];
+		if (entry->used && !memcmp(entry->image, message.data, sizeof(entry->image))) {
+			slot = entry;
+			break;
+		}
+		if (slot->used && (!entry->used || slot->requestMS - entry->requestMS < UINT32_MAX / 2)) {
+			// free entry, or else the least recently requested one
+			slot = entry;
+		}
+	}
+	(void)memcpy(slot->image, message.data, sizeof(slot->image));
+	slot->used = true;
+	slot->requestMS = hwMillis();
+}
+
+// Broadcast FW blocks are only relayed for images requested through this repeater
+static bool transportOTARelayBroadcast(const MyMessage &message)
+{
+	const uint8_t type = message.getType();
+	if (type != ST_FIRMWARE_RESPONSE && type != ST_FIRMWARE_RESPONSE_RLE) {
+		return true;
+	}
+	for (uint8_t i = 0; i < OTA_RELAY_IMAGES; i++) {
+		const otaRelayImage_t *entry = &_transportOTARelay[i];
+		if (entry->used && hwMillis() - entry->requestMS < OTA_RELAY_TIMEOUT_MS &&
+		        message.getLength() >= sizeof(entry->image) &&
+		        !memcmp(entry->image, message.data, sizeof(entry->image))) {
+			return true;
+		}
+	}
+	return false;
+}
+#endif
+
 void transportProcessMessage(void)
 {
 	// Manage signing timeout
@@ -653,6 +775,7 @@ void transportProcessMessage(void)
 	if (!transportHALReceive(&_msg, &payloadLength)) {
 		return;
 	}
+	LATENCY_MARK(LATENCY_RX_HAL);
 	// get message length and limit size
 	const uint8_t msgLength = _msg.getLength();
 	// calculate expected length
@@ -662,6 +785,12 @@ void transportProcessMessage(void)
 	const uint8_t sender = _msg.getSender();
 	const uint8_t last = _msg.getLast();
 	const uint8_t destination = _msg.getDestination();
+#if defined(MY_LINUX_METRICS)
+	metricsRadioRx(sender, last, transportHALGetReceivingRSSI());
+#endif
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+	transportNeighbourReceived(last, transportHALGetReceivingRSSI());
+#endif
 
 	TRANSPORT_DEBUG(PSTR("TSF:MSG:READ,%" PRIu8 "-%" PRIu8 "-%" PRIu8 ",s=%" PRIu8 ",c=%" PRIu8 ",t=%"
 	                     PRIu8 ",pt=%" PRIu8 ",l=%" PRIu8 ",sg=%" PRIu8 ":%s\n"),
@@ -670,9 +799,14 @@ void transportProcessMessage(void)
 	                                    type == I_NONCE_RESPONSE) ? "<NONCE>" : _msg.getString(_convBuf)));
 
 	// Reject messages that do not pass verification
-	if (!signerVerifyMsg(_msg)) {
+	const bool verified = signerVerifyMsg(_msg);
+	LATENCY_MARK(LATENCY_RX_VERIFY);
+	if (!verified) {
 		setIndication(INDICATION_ERR_SIGN);
 		TRANSPORT_DEBUG(PSTR("!TSF:MSG:SIGN VERIFY FAIL\n"));
+#if defined(MY_LINUX_METRICS)
+		metricsVerifyFailed(sender);
+#endif
 		return;
 	}
 
@@ -687,7 +821,7 @@ void transportProcessMessage(void)
 		// Message is from one of the child nodes and not sent from this node. Add it to routing table.
 		if (sender != _transportConfig.nodeId)
 		{
-			transportSetRoute(sender, last);
+			transportLearnRoute(sender, last);
 		}
 	}
 #endif // MY_REPEATER_FEATURE
@@ -811,6 +945,11 @@ void transportProcessMessage(void)
 				if(firmwareOTAUpdateProcess()) {
 					return; // OTA FW update processing indicated no further action needed
 				}
+#endif
+#if defined(MY_LINUX_OTA_CACHE)
+				if (type == ST_FIRMWARE_REQUEST && otaCacheRequest(_msg)) {
+					return; // answered from the gateway OTA cache
+				}
 #endif
 			}
 		} else {
@@ -825,7 +964,11 @@ void transportProcessMessage(void)
 #endif //defined(MY_OTA_LOG_RECEIVER_FEATURE)
 #if defined(MY_GATEWAY_FEATURE)
 		// Hand over message to controller
+		LATENCY_MARK(LATENCY_RX_ROUTE);
 		(void)gatewayTransportSend(_msg);
+#if defined(MY_LINUX_METRICS)
+		metricsGatewayForward();
+#endif
 #endif
 		// Call incoming message callback if available
 		if (receive) {
@@ -876,7 +1019,7 @@ void transportProcessMessage(void)
 #if defined(MY_REPEATER_FEATURE)
 		// controlled BC repeating: forward only if message received from parent and sender not self to prevent circular fwds
 		if(last == _transportConfig.parentNodeId && sender != _transportConfig.nodeId &&
-		        isTransportReady()) {
+		        isTransportReady() && (command != C_STREAM || transportOTARelayBroadcast(_msg))) {
 			TRANSPORT_DEBUG(PSTR("TSF:MSG:FWD BC MSG\n")); // controlled broadcast msg forwarding
 			(void)transportRouteMessage(_msg);
 		}
@@ -890,9 +1033,20 @@ void transportProcessMessage(void)
 				return;
 			}
 #endif
+#if defined(MY_OTA_FIRMWARE_FEATURE)
+			// FW blocks broadcast by a gateway OTA cache
+			if (command == C_STREAM && (type == ST_FIRMWARE_RESPONSE || type == ST_FIRMWARE_RESPONSE_RLE)) {
+				(void)firmwareOTAUpdateProcess();
+				return;
+			}
+#endif
 #if defined(MY_GATEWAY_FEATURE)
 			// Hand over message to controller
+			LATENCY_MARK(LATENCY_RX_ROUTE);
 			(void)gatewayTransportSend(_msg);
+#if defined(MY_LINUX_METRICS)
+			metricsGatewayForward();
+#endif
 #endif
 			if (receive) {
 				TRANSPORT_DEBUG(PSTR("TSF:MSG:RCV CB\n")); // hand over message to receive callback function
@@ -914,6 +1068,9 @@ void transportProcessMessage(void)
 					}
 				}
 			}
+			if (command == C_STREAM && type == ST_FIRMWARE_REQUEST) {
+				transportOTARelayRequest(_msg);
+			}
 			// Relay this message to another node
 			TRANSPORT_DEBUG(PSTR("TSF:MSG:REL MSG\n"));	// relay msg
 			(void)transportRouteMessage(_msg);
@@ -937,11 +1094,11 @@ void transportInvokeSanityCheck(void)
 	}
 }
 
-void transportProcessFIFO(void)
+bool transportProcessFIFO(const uint8_t budget)
 {
 	if (!_transportSM.transportActive) {
 		// transport not active, no further processing required
-		return;
+		return false;
 	}
 
 #if defined(MY_TRANSPORT_SANITY_CHECK)
@@ -951,10 +1108,13 @@ void transportProcessFIFO(void)
 	}
 #endif
 
-	uint8_t _processedMessages = MAX_SUBSEQ_MSGS;
-	// process all msgs in FIFO or counter exit
-	while (transportHALDataAvailable() && _processedMessages--) {
+	uint8_t processedMessages = 0;
+	// process all msgs in FIFO or budget exit
+	while (processedMessages < budget && transportHALDataAvailable()) {
+		LATENCY_BEGIN(LATENCY_PATH_RX);
 		transportProcessMessage();
+		LATENCY_END(LATENCY_PATH_RX);
+		processedMessages++;
 	}
 #if defined(MY_OTA_FIRMWARE_FEATURE)
 	if (isTransportReady()) {
@@ -962,19 +1122,12 @@ void transportProcessFIFO(void)
 		firmwareOTAUpdateRequest();
 	}
 #endif
+	return processedMessages == budget && transportHALDataAvailable();
 }
 
-bool transportSendWrite(const uint8_t to, MyMessage &message)
+// Send a message that is ready to go, i.e. signed if required
+static bool transportSendFrame(const uint8_t to, MyMessage &message)
 {
-	message.setLast(_transportConfig.nodeId); // Update last
-
-	// sign message if required
-	if (!signerSignMsg(message)) {
-		TRANSPORT_DEBUG(PSTR("!TSF:MSG:SIGN FAIL\n"));
-		setIndication(INDICATION_ERR_SIGN);
-		return false;
-	}
-
 	// msg length changes if signed
 	const uint8_t totalMsgLength = HEADER_SIZE + ( message.getSigned() ? MAX_PAYLOAD_SIZE :
 	                               message.getLength() );
@@ -983,6 +1136,15 @@ bool transportSendWrite(const uint8_t to, MyMessage &message)
 	setIndication(INDICATION_TX);
 	const bool result = transportHALSend(to, &message, totalMsgLength,
 	                                     noACK);
+	LATENCY_MARK(LATENCY_TX_HAL);
+#if defined(MY_LINUX_METRICS)
+	metricsRadioTx(to, noACK || result);
+#endif
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+	if (!noACK) {
+		transportNeighbourSent(to, result);
+	}
+#endif
 
 	TRANSPORT_DEBUG(PSTR("%sTSF:MSG:SEND,%" PRIu8 "-%" PRIu8 "-%" PRIu8 "-%" PRIu8 ",s=%" PRIu8 ",c=%"
 	                     PRIu8 ",t=%" PRIu8 ",pt=%" PRIu8 ",l=%" PRIu8 ",sg=%" PRIu8 ",ft=%" PRIu8 ",st=%s:%s\n"),
@@ -1000,6 +1162,34 @@ bool transportSendWrite(const uint8_t to, MyMessage &message)
 	return result;
 }
 
+transportSendResult_t transportSendWrite(const uint8_t to, MyMessage &message)
+{
+	LATENCY_MARK(LATENCY_TX_ROUTE);
+	message.setLast(_transportConfig.nodeId); // Update last
+
+	// sign message if required, messages waiting for a nonce are sent by the signer
+	const signerQueueResult_t signResult = signerQueueMsg(message, to);
+	LATENCY_MARK(LATENCY_TX_SIGN);
+	if (signResult == SIGNER_QUEUE_PENDING) {
+		return TRANSPORT_SEND_PENDING;
+	}
+	if (signResult == SIGNER_QUEUE_FAILED) {
+		TRANSPORT_DEBUG(PSTR("!TSF:MSG:SIGN FAIL\n"));
+		setIndication(INDICATION_ERR_SIGN);
+#if defined(MY_LINUX_METRICS)
+		metricsSignFailed();
+#endif
+		return TRANSPORT_SEND_FAILED;
+	}
+
+	return transportSendFrame(to, message) ? TRANSPORT_SEND_OK : TRANSPORT_SEND_FAILED;
+}
+
+bool transportSendQueued(const uint8_t route, MyMessage &message)
+{
+	return transportRouteComplete(route, message, transportSendFrame(route, message));
+}
+
 void transportRegisterReadyCallback(transportCallback_t cb)
 {
 	_transportReady_cb = cb;
@@ -1024,32 +1214,133 @@ void transportClearRoutingTable(void)
 	for (uint16_t i = 0; i < SIZE_ROUTES; i++) {
 		transportSetRoute((uint8_t)i, BROADCAST_ADDRESS);
 	}
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+	(void)memset((void *)_transportAlternates, BROADCAST_ADDRESS, sizeof(_transportAlternates));
+	(void)memset((void *)_transportNeighbours, BROADCAST_ADDRESS, sizeof(_transportNeighbours));
+#endif
 	transportSaveRoutingTable();	// save cleared routing table to EEPROM (if feature enabled)
 	TRANSPORT_DEBUG(PSTR("TSF:CRT:OK\n"));	// clear routing table
 }
 
 void transportLoadRoutingTable(void)
 {
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+	(void)memset((void *)_transportAlternates, BROADCAST_ADDRESS, sizeof(_transportAlternates));
+	(void)memset((void *)_transportNeighbours, BROADCAST_ADDRESS, sizeof(_transportNeighbours));
+#endif
 #if defined(MY_RAM_ROUTING_TABLE_ENABLED)
 	hwReadConfigBlock((void*)&_transportRoutingTable.route, (void*)EEPROM_ROUTES_ADDRESS, SIZE_ROUTES);
+	(void)memset((void *)_transportRoutingTable.dirty, 0, sizeof(_transportRoutingTable.dirty));
 	TRANSPORT_DEBUG(PSTR("TSF:LRT:OK\n"));	//  load routing table
+#elif defined(MY_RAM_ROUTING_CACHE_ENABLED)
+	(void)memset((void *)_transportRoutingCache, 0, sizeof(_transportRoutingCache));
 #endif
 }
 
+#if defined(MY_RAM_ROUTING_CACHE_ENABLED)
+// Cache entry of node, a miss replaces a not recently used entry (clock algorithm), preferably a
+// clean one, to defer EEPROM writes to transportSaveRoutingTable()
+static routingCacheEntry_t *transportRoutingCacheEntry(const uint8_t node)
+{
+	for (uint8_t i = 0; i < MY_RAM_ROUTING_CACHE_SIZE; i++) {
+		routingCacheEntry_t *entry = &_transportRoutingCache[i];
+		if ((entry->flags & ROUTING_CACHE_VALID) && entry->node == node) {
+			entry->flags |= ROUTING_CACHE_REFERENCED;
+			return entry;
+		}
+	}
+	routingCacheEntry_t *entry = NULL;
+	for (uint16_t step = 0; step < 2 * MY_RAM_ROUTING_CACHE_SIZE; step++) {
+		routingCacheEntry_t *candidate = &_transportRoutingCache[_transportRoutingCacheHand];
+		_transportRoutingCacheHand = (_transportRoutingCacheHand + 1) % MY_RAM_ROUTING_CACHE_SIZE;
+		if (!(candidate->flags & ROUTING_CACHE_VALID)) {
+			entry = candidate;
+			break;
+		}
+		if (candidate->flags & ROUTING_CACHE_REFERENCED) {
+			candidate->flags &= ~ROUTING_CACHE_REFERENCED;
+			continue;
+		}
+		// in the second round, all unreferenced entries are dirty
+		if (!(candidate->flags & ROUTING_CACHE_DIRTY) || step >= MY_RAM_ROUTING_CACHE_SIZE) {
+			entry = candidate;
+			break;
+		}
+	}
+	if (entry == NULL) {
+		entry = &_transportRoutingCache[_transportRoutingCacheHand];
+	}
+	if (entry->flags & ROUTING_CACHE_DIRTY) {
+		hwWriteConfig(EEPROM_ROUTES_ADDRESS + entry->node, entry->route);
+		_transportRoutingTableWrites++;
+	}
+	entry->node = node;
+	entry->route = hwReadConfig(EEPROM_ROUTES_ADDRESS + node);
+	entry->flags = ROUTING_CACHE_VALID | ROUTING_CACHE_REFERENCED;
+	return entry;
+}
+#endif
+
 void transportSaveRoutingTable(void)
 {
 #if defined(MY_RAM_ROUTING_TABLE_ENABLED)
-	hwWriteConfigBlock((void*)&_transportRoutingTable.route, (void*)EEPROM_ROUTES_ADDRESS, SIZE_ROUTES);
-	TRANSPORT_DEBUG(PSTR("TSF:SRT:OK\n"));	//  save routing table
+	// write runs of changed routes, short gaps of unchanged ones are written along
+	uint16_t written = 0;
+	uint16_t node = 0;
+	while (node < SIZE_ROUTES) {
+		if (!(_transportRoutingTable.dirty[node >> 3] & _BV(node & 7))) {
+			node++;
+			continue;
+		}
+		uint16_t end = node;
+		uint16_t cursor = node;
+		while (cursor < SIZE_ROUTES && (uint16_t)(cursor - end) <= ROUTING_TABLE_SAVE_GAP) {
+			if (_transportRoutingTable.dirty[cursor >> 3] & _BV(cursor & 7)) {
+				_transportRoutingTable.dirty[cursor >> 3] &= ~_BV(cursor & 7);
+				end = cursor;
+				written++;
+			}
+			cursor++;
+		}
+		hwWriteConfigBlock((void *)&_transportRoutingTable.route[node],
+		                   (void *)(uintptr_t)(EEPROM_ROUTES_ADDRESS + node), end - node + 1u);
+		node = end + 1;
+	}
+	_transportRoutingTableWrites += written;
+	TRANSPORT_DEBUG(PSTR("TSF:SRT:OK,W=%" PRIu16 "\n"), written);	//  save routing table
+#elif defined(MY_RAM_ROUTING_CACHE_ENABLED)
+	uint16_t written = 0;
+	for (uint8_t i = 0; i < MY_RAM_ROUTING_CACHE_SIZE; i++) {
+		routingCacheEntry_t *entry = &_transportRoutingCache[i];
+		if (entry->flags & ROUTING_CACHE_DIRTY) {
+			hwWriteConfig(EEPROM_ROUTES_ADDRESS + entry->node, entry->route);
+			entry->flags &= ~ROUTING_CACHE_DIRTY;
+			written++;
+		}
+	}
+	_transportRoutingTableWrites += written;
+	TRANSPORT_DEBUG(PSTR("TSF:SRT:OK,W=%" PRIu16 "\n"), written);	//  save routing table
 #endif
 }
 
 void transportSetRoute(const uint8_t node, const uint8_t route)
 {
 #if defined(MY_RAM_ROUTING_TABLE_ENABLED)
-	_transportRoutingTable.route[node] = route;
+	if (_transportRoutingTable.route[node] != route) {
+		_transportRoutingTable.route[node] = route;
+		_transportRoutingTable.dirty[node >> 3] |= _BV(node & 7);
+	}
+#elif defined(MY_RAM_ROUTING_CACHE_ENABLED)
+	routingCacheEntry_t *entry = transportRoutingCacheEntry(node);
+	if (entry->route != route) {
+		entry->route = route;
+		entry->flags |= ROUTING_CACHE_DIRTY;
+	}
 #else
-	hwWriteConfig(EEPROM_ROUTES_ADDRESS + node, route);
+	if (hwReadConfig(EEPROM_ROUTES_ADDRESS + node) != route) {
+		hwWriteConfig(EEPROM_ROUTES_ADDRESS + node, route);
+		_transportRoutingTableWrites++;
+	}
 #endif
 }
 
@@ -1058,26 +1349,344 @@ uint8_t transportGetRoute(const uint8_t node)
 	uint8_t result;
 #if defined(MY_RAM_ROUTING_TABLE_ENABLED)
 	result = _transportRoutingTable.route[node];
+#elif defined(MY_RAM_ROUTING_CACHE_ENABLED)
+	result = transportRoutingCacheEntry(node)->route;
 #else
 	result = hwReadConfig(EEPROM_ROUTES_ADDRESS + node);
 #endif
 	return result;
 }
 
+#if defined(MY_REPEATER_FEATURE)
+// Same as transportGetRoute(), but leaves the cache alone, for walking the whole table
+static uint8_t transportPeekRoute(const uint8_t node)
+{
+#if defined(MY_RAM_ROUTING_CACHE_ENABLED)
+	for (uint8_t i = 0; i < MY_RAM_ROUTING_CACHE_SIZE; i++) {
+		const routingCacheEntry_t *entry = &_transportRoutingCache[i];
+		if ((entry->flags & ROUTING_CACHE_VALID) && entry->node == node) {
+			return entry->route;
+		}
+	}
+	return hwReadConfig(EEPROM_ROUTES_ADDRESS + node);
+#else
+	return transportGetRoute(node);
+#endif
+}
+#endif
+
+uint32_t transportGetRoutingTableWrites(void)
+{
+	return _transportRoutingTableWrites;
+}
+
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+static uint16_t transportMinutes(void)
+{
+	return (uint16_t)(hwMillis() / (60 * 1000ul));
+}
+
+// Entry of node, or if create is set, a free or the least recently heard entry (to be initialised)
+static routingNeighbour_t *transportFindNeighbour(const uint8_t node, const bool create)
+{
+#if MY_ROUTING_NEIGHBOURS_SIZE >= ROUTING_NODE_IDS
+	// one entry per node id
+	if (node == BROADCAST_ADDRESS) {
+		return NULL;
+	}
+	routingNeighbour_t *entry = &_transportNeighbours[node];
+	return create || entry->node == node ? entry : NULL;
+#else
+	const uint16_t now = transportMinutes();
+	routingNeighbour_t *replace = NULL;
+	uint16_t replaceAge = 0;
+	for (uint8_t i = 0; i < MY_ROUTING_NEIGHBOURS_SIZE; i++) {
+		routingNeighbour_t *entry = &_transportNeighbours[i];
+		if (entry->node == node) {
+			return entry;
+		}
+		const uint16_t age = entry->node == BROADCAST_ADDRESS ? UINT16_MAX : (uint16_t)(now - entry->seenMin);
+		if (replace == NULL || age > replaceAge) {
+			replace = entry;
+			replaceAge = age;
+		}
+	}
+	return create ? replace : NULL;
+#endif
+}
+
+static routingAlternate_t *transportFindAlternate(const uint8_t node, const bool create)
+{
+#if MY_ROUTING_ALTERNATES_SIZE >= ROUTING_NODE_IDS
+	if (node == BROADCAST_ADDRESS) {
+		return NULL;
+	}
+	routingAlternate_t *entry = &_transportAlternates[node];
+	return create || entry->node == node ? entry : NULL;
+#else
+	const uint16_t now = transportMinutes();
+	routingAlternate_t *replace = NULL;
+	uint16_t replaceAge = 0;
+	for (uint8_t i = 0; i < MY_ROUTING_ALTERNATES_SIZE; i++) {
+		routingAlternate_t *entry = &_transportAlternates[i];
+		if (entry->node == node) {
+			return entry;
+		}
+		const uint16_t age = entry->node == BROADCAST_ADDRESS ? UINT16_MAX :
+		                     min((uint16_t)(now - entry->primarySeenMin), (uint16_t)(now - entry->alternateSeenMin));
+		if (replace == NULL || age > replaceAge) {
+			replace = entry;
+			replaceAge = age;
+		}
+	}
+	return create ? replace : NULL;
+#endif
+}
+
+static routingNeighbour_t *transportUpdateNeighbour(const uint8_t node)
+{
+	routingNeighbour_t *neighbour = transportFindNeighbour(node, true);
+	if (neighbour->node != node) {
+		neighbour->node = node;
+		neighbour->delivery = UINT8_MAX;
+		neighbour->rssi = INT8_MIN;
+	}
+	neighbour->seenMin = transportMinutes();
+	return neighbour;
+}
+
+static void transportNeighbourReceived(const uint8_t node, const int16_t RSSI)
+{
+	routingNeighbour_t *neighbour = transportUpdateNeighbour(node);
+	if (RSSI != INVALID_RSSI) {
+		const int16_t clamped = max((int16_t)(INT8_MIN + 1), min(RSSI, (int16_t)0));
+		neighbour->rssi = neighbour->rssi == INT8_MIN ? (int8_t)clamped :
+		                  (int8_t)((neighbour->rssi * 3 + clamped) / 4);
+	}
+}
+
+static void transportNeighbourSent(const uint8_t node, const bool delivered)
+{
+	routingNeighbour_t *neighbour = transportUpdateNeighbour(node);
+	neighbour->delivery = (uint8_t)((neighbour->delivery * 7u + (delivered ? UINT8_MAX : 0u) + 4u) / 8u);
+}
+
+// True if the link to alternate is stale, or worse than the link to primary: delivery first,
+// RSSI if both deliver alike. Neighbours without metrics are not held against
+static bool transportNeighbourWorse(const uint8_t alternate, const uint8_t primary)
+{
+	const routingNeighbour_t *candidate = transportFindNeighbour(alternate, false);
+	if (candidate == NULL) {
+		return false;
+	}
+	if ((uint16_t)(transportMinutes() - candidate->seenMin) > MY_ROUTING_ALTERNATE_MAX_AGE_MIN) {
+		return true;
+	}
+	const routingNeighbour_t *current = transportFindNeighbour(primary, false);
+	if (current == NULL) {
+		return false;
+	}
+	if (candidate->delivery != current->delivery) {
+		return candidate->delivery < current->delivery;
+	}
+	return candidate->rssi != INT8_MIN && current->rssi != INT8_MIN && candidate->rssi < current->rssi;
+}
+
+static bool transportRouteFailover(const uint8_t destination, const uint8_t route,
+                                   MyMessage &message)
+{
+	routingAlternate_t *entry = transportFindAlternate(destination, false);
+	const uint8_t alternate = transportGetAlternateRoute(destination);
+	if (entry == NULL || alternate == BROADCAST_ADDRESS || alternate == route) {
+		return false;
+	}
+	// the failed send already lowered the delivery of route
+	if (transportNeighbourWorse(alternate, route)) {
+		TRANSPORT_DEBUG(PSTR("!TSF:RTE:%" PRIu8 " FAILOVER SKIP,R=%" PRIu8 "\n"), destination, alternate);
+		return false;
+	}
+	TRANSPORT_DEBUG(PSTR("TSF:RTE:%" PRIu8 " FAILOVER,R=%" PRIu8 "\n"), destination, alternate);
+	// the message is signed already, do not sign it again
+	if (!transportSendFrame(alternate, message)) {
+		return false;
+	}
+	// alternate works, swap routes
+	transportSetRoute(destination, alternate);
+	entry->alternate = route;
+	const uint16_t primarySeenMin = entry->primarySeenMin;
+	entry->primarySeenMin = entry->alternateSeenMin;
+	entry->alternateSeenMin = primarySeenMin;
+	return true;
+}
+#endif
+
+void transportLearnRoute(const uint8_t node, const uint8_t route)
+{
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+	const uint8_t primary = transportGetRoute(node);
+	const uint16_t now = transportMinutes();
+	routingAlternate_t *entry = transportFindAlternate(node, primary != route &&
+	                            primary != BROADCAST_ADDRESS);
+	if (entry == NULL) {
+		// first route, or same route without alternate
+		if (primary != route) {
+			transportSetRoute(node, route);
+		}
+		return;
+	}
+	if (entry->node != node) {
+		entry->node = node;
+		entry->alternate = BROADCAST_ADDRESS;
+		entry->primarySeenMin = now;
+		entry->alternateSeenMin = now;
+	}
+	if (primary != route) {
+		// heard through another hop, most likely the node changed its parent
+		transportSetRoute(node, route);
+		entry->alternate = primary;
+		entry->alternateSeenMin = entry->primarySeenMin;
+	}
+	entry->primarySeenMin = now;
+#else
+	transportSetRoute(node, route);
+#endif
+}
+
+uint8_t transportGetAlternateRoute(const uint8_t node)
+{
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+	const routingAlternate_t *entry = transportFindAlternate(node, false);
+	if (entry != NULL && (uint16_t)(transportMinutes() - entry->alternateSeenMin) <=
+	        MY_ROUTING_ALTERNATE_MAX_AGE_MIN) {
+		return entry->alternate;
+	}
+#else
+	(void)node;
+#endif
+	return BROADCAST_ADDRESS;
+}
+
+uint8_t transportGetNeighbourQuality(const uint8_t node)
+{
+#if defined(MY_ROUTING_ALTERNATES_ENABLED)
+	const routingNeighbour_t *neighbour = transportFindNeighbour(node, false);
+	if (neighbour != NULL) {
+		return neighbour->delivery;
+	}
+#else
+	(void)node;
+#endif
+	return 0;
+}
+
+#if defined(MY_REPEATER_FEATURE)
+// Send a routing table export frame, retry with increasing delay on failure
+static bool transportSendRoutingFrame(const uint8_t *frame, const uint8_t length,
+                                      uint32_t &delayMS)
+{
+	for (uint8_t attempt = 0; attempt < ROUTING_EXPORT_ATTEMPTS; attempt++) {
+		const bool result = _sendRoute(build(_msgTmp, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL,
+		                                     I_DEBUG).set(frame, length));
+		delayMS = result ? max(delayMS / 2, (uint32_t)ROUTING_EXPORT_MIN_DELAY_MS) :
+		          min(delayMS * 2, (uint32_t)ROUTING_EXPORT_MAX_DELAY_MS);
+		wait(delayMS);
+		if (result) {
+			return true;
+		}
+	}
+	return false;
+}
+#endif
+
 void transportReportRoutingTable(void)
 {
 #if defined(MY_REPEATER_FEATURE)
+	uint32_t delayMS = ROUTING_EXPORT_MIN_DELAY_MS;
 	for (uint16_t cnt = 0; cnt < SIZE_ROUTES; cnt++) {
-		const uint8_t route = transportGetRoute(cnt);
+		const uint8_t route = transportPeekRoute(cnt);
 		if (route != BROADCAST_ADDRESS) {
 			TRANSPORT_DEBUG(PSTR("TSF:RRT:ROUTE N=%" PRIu8 ",R=%" PRIu8 "\n"), cnt, route);
 			uint8_t outBuf[2] = { (uint8_t)cnt,route };
-			(void)_sendRoute(build(_msgTmp, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_DEBUG).set(outBuf,
-			                 2));
-			wait(200);
+			if (!transportSendRoutingFrame(outBuf, 2, delayMS)) {
+				return;
+			}
+		}
+	}
+#endif
+}
+
+void transportExportRoutingTable(void)
+{
+#if defined(MY_REPEATER_FEATURE)
+	uint8_t frame[MAX_PAYLOAD_SIZE];
+	uint8_t length = 1;
+	uint8_t frameNumber = 0;
+	uint16_t exported = 0;
+	uint32_t delayMS = ROUTING_EXPORT_MIN_DELAY_MS;
+	for (uint16_t node = 0; node < SIZE_ROUTES; node++) {
+		const uint8_t route = transportPeekRoute(node);
+		if (route != BROADCAST_ADDRESS) {
+			frame[length++] = (uint8_t)node;
+			frame[length++] = route;
+			frame[length++] = transportGetNeighbourQuality(route);
+			exported++;
+		}
+		const bool last = node == SIZE_ROUTES - 1;
+		if (last || length + 3u > MAX_PAYLOAD_SIZE) {
+			frame[0] = (frameNumber++ & ~ROUTING_EXPORT_LAST_FRAME) | (last ? ROUTING_EXPORT_LAST_FRAME : 0);
+			if (!transportSendRoutingFrame(frame, length, delayMS)) {
+				TRANSPORT_DEBUG(PSTR("!TSF:RTX:FAIL,N=%" PRIu16 "\n"), exported);	// export aborted
+				return;
+			}
+			length = 1;
 		}
 	}
+	TRANSPORT_DEBUG(PSTR("TSF:RTX:OK,N=%" PRIu16 "\n"), exported);	// routing table exported
+#endif
+}
+
+uint8_t transportImportRoutes(const char *hex, const uint8_t length, uint8_t *rejected)
+{
+	uint8_t imported = 0;
+	*rejected = 0;
+#if defined(MY_REPEATER_FEATURE)
+	if (length % 4 != 0) {
+		TRANSPORT_DEBUG(PSTR("!TSF:RTI:LEN,%" PRIu8 "\n"), length);	// not a list of node/route tuples
+		*rejected = (length + 3) / 4;
+		return 0;
+	}
+	uint8_t cleared = 0;
+	for (uint8_t i = 0; i < length; i += 4) {
+		bool valid = true;
+		for (uint8_t digit = i; digit < i + 4u; digit++) {
+			valid = valid && isxdigit((unsigned char)hex[digit]);
+		}
+		if (!valid) {
+			(*rejected)++;
+			continue;
+		}
+		const uint8_t node = (convertH2I(hex[i]) << 4) | convertH2I(hex[i + 1]);
+		const uint8_t route = (convertH2I(hex[i + 2]) << 4) | convertH2I(hex[i + 3]);
+		// the gateway is reached through the parent, broadcasts are not routed
+		if (node == GATEWAY_ADDRESS || node == BROADCAST_ADDRESS || node == _transportConfig.nodeId) {
+			TRANSPORT_DEBUG(PSTR("!TSF:RTI:INVALID,N=%" PRIu8 "\n"), node);	// record rejected
+			(*rejected)++;
+			continue;
+		}
+		if (route == BROADCAST_ADDRESS) {
+			cleared++;
+		}
+		transportSetRoute(node, route);
+		imported++;
+	}
+	// routes imported, cleared routes included, and rejected records
+	TRANSPORT_DEBUG(PSTR("TSF:RTI:OK,N=%" PRIu8 ",C=%" PRIu8 ",R=%" PRIu8 "\n"), imported, cleared,
+	                *rejected);
+#else
+	(void)hex;
+	(void)length;
 #endif
+	return imported;
 }
 
 void transportTogglePassiveMode(const bool OnOff)
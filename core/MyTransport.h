@@ -237,6 +237,17 @@
 #define INVALID_HOPS					(255u)			//!< invalid hops
 #define MAX_SUBSEQ_MSGS				(5u)				//!< Maximum number of subsequently processed messages in FIFO (to prevent transport deadlock if HW issue)
 #define UPLINK_QUALITY_WEIGHT	(0.05f)			//!< UPLINK_QUALITY_WEIGHT
+#define ROUTING_TABLE_SAVE_GAP	(8u)				//!< Unchanged routes between changed ones that are written along rather than splitting the EEPROM write
+#define ROUTING_EXPORT_LAST_FRAME	(0x80u)			//!< Set in the header byte of the last routing table export frame
+#define ROUTING_EXPORT_ATTEMPTS		(3u)			//!< Attempts to send a routing table export frame
+#define ROUTING_EXPORT_MIN_DELAY_MS	(20u)			//!< Delay between routing table export frames after successful sends
+#define ROUTING_EXPORT_MAX_DELAY_MS	(640u)			//!< Delay between routing table export frames after failed sends
+#define ROUTING_NODE_IDS			(255u)			//!< Node ids with a route, 0..254; neighbour and alternate tables of this size are indexed by node id
+#define ROUTING_CACHE_VALID			(0x01u)			//!< Routing cache entry in use
+#define ROUTING_CACHE_REFERENCED	(0x02u)			//!< Routing cache entry used since the last replacement round
+#define ROUTING_CACHE_DIRTY			(0x04u)			//!< Routing cache entry not saved to EEPROM
+#define OTA_RELAY_IMAGES			(2u)			//!< FW images requested through a repeater, broadcast FW blocks of other images are not relayed
+#define OTA_RELAY_TIMEOUT_MS		(10*1000ul)		//!< Broadcast FW blocks of an image are relayed this long after the last request for it
 
 
 // parent node check
@@ -317,8 +328,56 @@ typedef struct {
 */
 typedef struct {
 	uint8_t route[SIZE_ROUTES];	//!< route for node
+	uint8_t dirty[SIZE_ROUTES / 8];	//!< route changed since the last save, one bit per node
 } routingTable_t;
 
+/**
+* @brief RAM routing cache entry, for repeaters without a RAM routing table
+*/
+typedef struct {
+	uint8_t node;			//!< node
+	uint8_t route;			//!< route for node
+	uint8_t flags;			//!< ROUTING_CACHE_VALID, ROUTING_CACHE_REFERENCED, ROUTING_CACHE_DIRTY
+} routingCacheEntry_t;
+
+/**
+* @brief Link quality of a neighbour, i.e. a next hop
+*/
+typedef struct {
+	uint8_t node;			//!< neighbour, BROADCAST_ADDRESS if unused
+	uint8_t delivery;		//!< moving average of acknowledged sends, 255 = all, ETX = 255 / delivery
+	int8_t rssi;			//!< moving average of the receiving RSSI, INT8_MIN if unknown
+	uint16_t seenMin;		//!< last message received from or sent to the neighbour, in minutes
+} routingNeighbour_t;
+
+/**
+* @brief Alternate route, the primary route is in the routing table
+*/
+typedef struct {
+	uint8_t node;			//!< node, BROADCAST_ADDRESS if unused
+	uint8_t alternate;		//!< alternate next hop
+	uint16_t primarySeenMin;	//!< last message received via the primary next hop, in minutes
+	uint16_t alternateSeenMin;	//!< last message received via the alternate next hop, in minutes
+} routingAlternate_t;
+
+/**
+* @brief FW image a child requested through this repeater, see @ref OTA_RELAY_IMAGES
+*/
+typedef struct {
+	uint8_t image[4];		//!< FW type and version as in the request
+	uint8_t used;			//!< entry holds an image
+	uint32_t requestMS;		//!< last request for the image
+} otaRelayImage_t;
+
+/**
+ * @brief Result of @ref transportSendWrite()
+ */
+typedef enum {
+	TRANSPORT_SEND_FAILED = 0,	//!< Message not sent
+	TRANSPORT_SEND_OK,			//!< Message sent
+	TRANSPORT_SEND_PENDING		//!< Message waits for a nonce, the signer sends it later
+} transportSendResult_t;
+
 // PRIVATE functions
 
 /**
@@ -384,13 +443,20 @@ void transportUpdateSM(void);
 */
 uint32_t transportTimeInState(void);
 /**
+* @brief Request time until transport needs to be processed again
+* @return ms until the next timer (state timeout, sanity check, discovery) is due, 0 if messages are pending
+*/
+uint32_t transportTimeToNextEvent(void);
+/**
 * @brief Call transport driver sanity check
 */
 void transportInvokeSanityCheck(void);
 /**
-* @brief Process all pending messages in RX FIFO
+* @brief Process pending messages in RX FIFO
+* @param budget max number of messages to process
+* @return true if messages are left in the FIFO
 */
-void transportProcessFIFO(void);
+bool transportProcessFIFO(const uint8_t budget = MAX_SUBSEQ_MSGS);
 /**
 * @brief Receive message from RX FIFO and process
 */
@@ -434,9 +500,20 @@ bool transportSendRoute(MyMessage &message);
 * @brief Send message to recipient
 * @param to Recipient of message
 * @param message
+* @return @ref TRANSPORT_SEND_OK if message sent successfully, @ref TRANSPORT_SEND_PENDING if the
+*         signer queued it until the nonce arrives (see @ref transportSendQueued())
+*/
+transportSendResult_t transportSendWrite(const uint8_t to, MyMessage &message);
+/**
+* @brief Send a message the signer queued in @ref transportSendWrite(), once it is signed
+*
+* The message goes to the route it was queued for, failover and the uplink failure counter are
+* updated with the result as for any other message.
+* @param route Recipient the message was queued for
+* @param message Signed message
 * @return true if message sent successfully
 */
-bool transportSendWrite(const uint8_t to, MyMessage &message);
+bool transportSendQueued(const uint8_t route, MyMessage &message);
 /**
 * @brief Check uplink to GW, includes flooding control
 * @param force to override flood control timer
@@ -500,7 +577,7 @@ uint32_t transportGetHeartbeat(void);
 */
 void transportLoadRoutingTable(void);
 /**
-* @brief Save routing table to EEPROM.
+* @brief Save the routes changed since the last save to EEPROM.
 */
 void transportSaveRoutingTable(void);
 /**
@@ -516,10 +593,50 @@ void transportSetRoute(const uint8_t node, const uint8_t route);
 */
 uint8_t transportGetRoute(const uint8_t node);
 /**
+* @brief EEPROM wear of the routing table
+* @return Number of routing table bytes written to EEPROM since start
+*/
+uint32_t transportGetRoutingTableWrites(void);
+/**
+* @brief Update the routes of a node heard through a next hop, the previous route becomes the
+* alternate (only with MY_ROUTING_ALTERNATES_ENABLED, otherwise like transportSetRoute())
+* @param node
+* @param route next hop the node was heard through
+*/
+void transportLearnRoute(const uint8_t node, const uint8_t route);
+/**
+* @brief Alternate route to node
+* @param node
+* @return alternate next hop, BROADCAST_ADDRESS if none or outdated
+*/
+uint8_t transportGetAlternateRoute(const uint8_t node);
+/**
+* @brief Link quality of a neighbour
+* @param node neighbour
+* @return share of acknowledged sends (255 = all), 0 if unknown
+*/
+uint8_t transportGetNeighbourQuality(const uint8_t node);
+/**
 * @brief Reports content of routing table
 */
 void transportReportRoutingTable(void);
 /**
+* @brief Sends the routing table to the controller in I_DEBUG messages
+*
+* Each message holds a header byte with the frame number (bit 7 set in the last frame) followed
+* by up to 8 tuples of node, route and link quality of the route (see
+* transportGetNeighbourQuality()). The delay between messages adapts to send failures.
+*/
+void transportExportRoutingTable(void);
+/**
+* @brief Imports routes
+* @param hex tuples of node and route, two hex digits each
+* @param length length of hex
+* @param rejected number of records that were not hex digits or had node 0, 255 or this node
+* @return number of imported routes, cleared routes (route FF) included
+*/
+uint8_t transportImportRoutes(const char *hex, const uint8_t length, uint8_t *rejected);
+/**
 * @brief Get node ID
 * @return node ID
 */
@@ -27,7 +27,9 @@
 //#define MY_LINUX_CONFIG_FILE "/etc/mysensors.conf"
 
 // How many clients should be able to connect to this gateway (default 1)
+#ifndef MY_GATEWAY_MAX_CLIENTS
 #define MY_GATEWAY_MAX_CLIENTS 10
+#endif
 
 // Serial config
 // Enable this if you are using an Arduino connected to the USB
@@ -32,11 +32,16 @@ bool hwInit(void)
 		exit(1);
 	}
 #endif
+#ifndef MY_LINUX_SERIAL_PORT
+	// Controller talks through stdin, wake the main loop on input
+	eventLoopAdd(STDIN_FILENO);
+#endif
 #endif
 
 	if (eeprom.init(conf.eeprom_file, conf.eeprom_size) != 0) {
 		exit(1);
 	}
+	eeprom.setFlushDelay(MY_LINUX_EEPROM_FLUSH_DELAY_MS);
 
 	return true;
 }
@@ -61,6 +66,16 @@ void hwWriteConfig(const int addr, uint8_t value)
 	eeprom.writeByte(addr, value);
 }
 
+uint32_t hwConfigSync(void)
+{
+	return eeprom.sync();
+}
+
+void hwConfigFlush(void)
+{
+	(void)eeprom.flush();
+}
+
 void hwRandomNumberInit(void)
 {
 	uint32_t seed=0;
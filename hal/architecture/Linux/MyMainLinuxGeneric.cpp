@@ -27,19 +27,36 @@
 #include <syslog.h>
 #include <errno.h>
 #include <getopt.h>
+#if defined(MY_LINUX_METRICS)
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
 #include "log.h"
 #include "config.h"
 #include "MySensorsCore.h"
 
+static volatile sig_atomic_t _shutdownSignal = 0;
+
 void handle_sigint(int sig)
 {
-	if (sig == SIGINT) {
-		logNotice("Received SIGINT\n\n");
-	} else if (sig == SIGTERM) {
-		logNotice("Received SIGTERM\n\n");
-	} else {
+	if (sig != SIGINT && sig != SIGTERM) {
+		return;
+	}
+	if (_shutdownSignal) {
+		// Second signal, stuck outside a yield point (e.g. connecting), terminate right away
+		(void)signal(sig, SIG_DFL);
+		(void)raise(sig);
 		return;
 	}
+	// Only async-signal-safe calls here, the next doYield() shuts down
+	_shutdownSignal = sig;
+	eventLoopWakeup();
+}
+
+static void shutdown_gateway(void)
+{
+	logNotice("Received %s\n\n", _shutdownSignal == SIGINT ? "SIGINT" : "SIGTERM");
 
 #ifdef MY_RF24_IRQ_PIN
 	detachInterrupt(MY_RF24_IRQ_PIN);
@@ -49,11 +66,134 @@ void handle_sigint(int sig)
 	MY_SERIALDEVICE.end();
 #endif
 
+	// Before logClose(), so that errors still reach the log
+	hwConfigFlush();
+
 	logClose();
 
 	exit(EXIT_SUCCESS);
 }
 
+void hwShutdownCheck(void)
+{
+	if (_shutdownSignal) {
+		shutdown_gateway();
+	}
+}
+
+#if defined(MY_DEBUG_LATENCY)
+void handle_sigusr1(int sig)
+{
+	(void)sig;
+	latencyRequestPrint();
+}
+#endif
+
+#if defined(MY_LINUX_METRICS)
+static void metricsServe(const int client)
+{
+	const struct timeval timeout = {2, 0};
+	char request[1024];
+	size_t length = 0;
+	std::string body;
+	const char *status = "200 OK";
+
+	(void)setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	(void)setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	// Read the request head, only the request line matters
+	request[0] = '\0';
+	while (strstr(request, "\r\n\r\n") == NULL && strstr(request, "\n\n") == NULL) {
+		if (length == sizeof(request) - 1) {
+			break;
+		}
+		const ssize_t received = recv(client, request + length, sizeof(request) - 1 - length, 0);
+		if (received <= 0) {
+			return;
+		}
+		length += received;
+		request[length] = '\0';
+	}
+
+	if (strncmp(request, "GET ", 4) != 0) {
+		status = "405 Method Not Allowed";
+	} else if (strncmp(request + 4, "/metrics ", 9) != 0 && strncmp(request + 4, "/ ", 2) != 0) {
+		status = "404 Not Found";
+	} else if (!metricsSnapshot(body, 1000)) {
+		status = "503 Service Unavailable";
+	}
+
+	char header[160];
+	const int headerLength = snprintf(header, sizeof(header),
+	                                  "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+	                                  "Content-Length: %zu\r\nConnection: close\r\n\r\n", status, body.size());
+	if (send(client, header, headerLength, MSG_NOSIGNAL) != headerLength) {
+		return;
+	}
+	for (size_t sent = 0; sent < body.size(); ) {
+		const ssize_t result = send(client, body.data() + sent, body.size() - sent, MSG_NOSIGNAL);
+		if (result <= 0) {
+			return;
+		}
+		sent += result;
+	}
+}
+
+static void *metricsServer(void *arg)
+{
+	const int listener = (int)(intptr_t)arg;
+
+	eventLoopBlockSignals();
+	for (;;) {
+		const int client = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+		if (client == -1) {
+			if (errno != EINTR && errno != ECONNABORTED) {
+				logError("metrics: accept: %s\n", strerror(errno));
+				delay(1000);
+			}
+			continue;
+		}
+		metricsServe(client);
+		close(client);
+	}
+	return NULL;
+}
+
+static void metricsServerStart(const uint16_t port)
+{
+	struct sockaddr_in6 address;
+	const int enable = 1;
+	const int disable = 0;
+	pthread_t thread;
+
+	const int listener = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listener == -1) {
+		logError("metrics: socket: %s\n", strerror(errno));
+		return;
+	}
+	(void)setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+	// Accept IPv4 as well
+	(void)setsockopt(listener, IPPROTO_IPV6, IPV6_V6ONLY, &disable, sizeof(disable));
+	memset(&address, 0, sizeof(address));
+	address.sin6_family = AF_INET6;
+	address.sin6_addr = in6addr_any;
+	address.sin6_port = htons(port);
+	if (bind(listener, (struct sockaddr *)&address, sizeof(address)) == -1 ||
+	        listen(listener, 4) == -1) {
+		logError("metrics: port %d: %s\n", port, strerror(errno));
+		close(listener);
+		return;
+	}
+	if (pthread_create(&thread, NULL, metricsServer, (void *)(intptr_t)listener) != 0) {
+		logError("metrics: failed to start the server thread\n");
+		close(listener);
+		return;
+	}
+	pthread_detach(thread);
+	logInfo("Serving metrics on port %d\n", port);
+}
+#endif
+
 static int daemonize(void)
 {
 	pid_t pid, sid;
@@ -354,6 +494,9 @@ int main(int argc, char *argv[])
 	signal(SIGINT, handle_sigint);
 	signal(SIGTERM, handle_sigint);
 	signal(SIGPIPE, handle_sigint);
+#if defined(MY_DEBUG_LATENCY)
+	signal(SIGUSR1, handle_sigusr1);
+#endif
 
 	hwRandomNumberInit();
 
@@ -441,6 +584,14 @@ int main(int argc, char *argv[])
 		logSetSyslog(LOG_CONS, LOG_USER);
 	}
 
+	if (logSetAsync(MY_LINUX_LOG_QUEUE_SIZE) != 0) {
+		logError("Failed to start the log writer, logging synchronously.\n");
+	}
+
+#if defined(MY_LINUX_OTA_CACHE)
+	otaCacheInit(conf.ota_cache_file);
+#endif
+
 	logInfo("Starting gateway...\n");
 	logInfo("Protocol version - %s\n", MYSENSORS_LIBRARY_VERSION);
 
@@ -478,11 +629,16 @@ int main(int argc, char *argv[])
 		free(config_file);
 	}
 
-	for (;;) {
+#if defined(MY_LINUX_METRICS)
+	metricsServerStart(MY_LINUX_METRICS_PORT);
+#endif
+
+	while (!_shutdownSignal) {
 		_process();  // Process incoming data
 		if (loop) {
 			loop(); // Call sketch loop
 		}
 	}
+	shutdown_gateway();
 	return 0;
 }
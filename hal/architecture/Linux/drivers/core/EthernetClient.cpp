@@ -32,12 +32,13 @@
 #include <netinet/tcp.h>
 #include <errno.h>
 #include "log.h"
+#include "eventloop.h"
 
-EthernetClient::EthernetClient() : _sock(-1)
+EthernetClient::EthernetClient() : _sock(-1), _rxStart(0), _rxEnd(0), _rxDiscard(false)
 {
 }
 
-EthernetClient::EthernetClient(int sock) : _sock(sock)
+EthernetClient::EthernetClient(int sock) : _sock(sock), _rxStart(0), _rxEnd(0), _rxDiscard(false)
 {
 }
 
@@ -100,6 +101,7 @@ int EthernetClient::connect(const char* host, uint16_t port)
 	void *addr = &(((struct sockaddr_in*)p->ai_addr)->sin_addr);
 	inet_ntop(p->ai_family, addr, s, sizeof s);
 	logDebug("connected to %s\n", s);
+	eventLoopAdd(_sock);
 
 	freeaddrinfo(servinfo); // all done with this structure
 	if (use_bind) {
@@ -155,41 +157,99 @@ size_t EthernetClient::write(const char *buffer, size_t size)
 
 int EthernetClient::available()
 {
-	int count = 0;
-
-	if (_sock != -1) {
-		ioctl(_sock, SIOCINQ, &count);
+	if (_rxStart == _rxEnd) {
+		_fill();
 	}
 
-	return count;
+	return _rxEnd - _rxStart;
 }
 
 int EthernetClient::read()
 {
-	uint8_t b;
-	if ( recv(_sock, &b, 1, MSG_DONTWAIT) > 0 ) {
-		// recv worked
-		return b;
-	} else {
+	if (!available()) {
 		// No data available
 		return -1;
 	}
+
+	uint8_t b = _rxBuffer[_rxStart];
+	_consume(1);
+	return b;
 }
 
 int EthernetClient::read(uint8_t *buf, size_t bytes)
 {
-	return recv(_sock, buf, bytes, MSG_DONTWAIT);
+	if (!available()) {
+		return -1;
+	}
+
+	size_t n = _rxEnd - _rxStart;
+	if (n > bytes) {
+		n = bytes;
+	}
+	memcpy(buf, _rxBuffer + _rxStart, n);
+	_consume(n);
+	return n;
 }
 
 int EthernetClient::peek()
 {
-	uint8_t b;
-
-	if (recv(_sock, &b, 1, MSG_PEEK | MSG_DONTWAIT) > 0) {
-		return b;
-	} else {
+	if (!available()) {
 		return -1;
 	}
+
+	return _rxBuffer[_rxStart];
+}
+
+int EthernetClient::readLine(char *buffer, size_t length)
+{
+	while (true) {
+		const uint8_t *eol = _findEol();
+
+		if (eol == NULL && _fill() > 0) {
+			eol = _findEol();
+		}
+
+		if (eol == NULL) {
+			const size_t buffered = _rxEnd - _rxStart;
+			if (!_rxDiscard && buffered < length - 1) {
+				// Wait for the rest of the line
+				return ETHERNETCLIENT_LINE_NONE;
+			}
+			// Drop the line up to its terminator, it is reported once
+			const bool reported = _rxDiscard;
+			_rxDiscard = true;
+			_consume(buffered);
+			return reported ? ETHERNETCLIENT_LINE_NONE : ETHERNETCLIENT_LINE_TOO_LONG;
+		}
+
+		size_t n = eol - (_rxBuffer + _rxStart);
+		if (_rxDiscard) {
+			// Tail of a line that was too long
+			_rxDiscard = false;
+			_consume(n + 1);
+			continue;
+		}
+		if (n > length - 1) {
+			_consume(n + 1);
+			return ETHERNETCLIENT_LINE_TOO_LONG;
+		}
+		memcpy(buffer, _rxBuffer + _rxStart, n);
+		buffer[n] = 0;
+		// Skip the terminator, but do not flag a partial line as pending
+		_rxStart += n + 1;
+		if (_rxStart == _rxEnd) {
+			_rxStart = _rxEnd = 0;
+		} else if (_findEol() != NULL) {
+			eventLoopPending();
+		}
+
+		return n;
+	}
+}
+
+bool EthernetClient::hasLine()
+{
+	return _findEol() != NULL;
 }
 
 void EthernetClient::flush()
@@ -231,8 +291,11 @@ void EthernetClient::stop()
 	         1000000);
 
 	// free up the socket descriptor
+	eventLoopRemove(_sock);
 	::close(_sock);
 	_sock = -1;
+	_rxStart = _rxEnd = 0;
+	_rxDiscard = false;
 }
 
 uint8_t EthernetClient::status()
@@ -279,12 +342,67 @@ uint8_t EthernetClient::connected()
 	return status() == ETHERNETCLIENT_W5100_ESTABLISHED || available();
 }
 
+int EthernetClient::_fill()
+{
+	if (_sock == -1) {
+		return -1;
+	}
+
+	if (_rxStart == _rxEnd) {
+		_rxStart = _rxEnd = 0;
+	} else if (_rxStart > 0 && _rxEnd == sizeof(_rxBuffer)) {
+		// Make room at the end
+		memmove(_rxBuffer, _rxBuffer + _rxStart, _rxEnd - _rxStart);
+		_rxEnd -= _rxStart;
+		_rxStart = 0;
+	}
+
+	if (_rxEnd == sizeof(_rxBuffer)) {
+		return 0;
+	}
+
+	int rc = recv(_sock, _rxBuffer + _rxEnd, sizeof(_rxBuffer) - _rxEnd, MSG_DONTWAIT);
+	if (rc > 0) {
+		_rxEnd += rc;
+	}
+
+	return rc;
+}
+
+const uint8_t *EthernetClient::_findEol()
+{
+	const uint8_t *start = _rxBuffer + _rxStart;
+	size_t n = _rxEnd - _rxStart;
+
+	const uint8_t *eol = (const uint8_t *)memchr(start, '\n', n);
+	if (eol != NULL) {
+		n = eol - start;
+	}
+	const uint8_t *cr = (const uint8_t *)memchr(start, '\r', n);
+
+	return cr != NULL ? cr : eol;
+}
+
+void EthernetClient::_consume(size_t bytes)
+{
+	_rxStart += bytes;
+	if (_rxStart == _rxEnd) {
+		_rxStart = _rxEnd = 0;
+	} else {
+		// epoll does not see buffered data, keep the loop awake
+		eventLoopPending();
+	}
+}
+
 void EthernetClient::close()
 {
 	if (_sock != -1) {
+		eventLoopRemove(_sock);
 		::close(_sock);
 		_sock = -1;
 	}
+	_rxStart = _rxEnd = 0;
+	_rxDiscard = false;
 }
 
 void EthernetClient::bind(IPAddress ip)
@@ -37,6 +37,13 @@
 #define ETHERNETCLIENT_W5100_CLOSE_WAIT 0x1C
 #define ETHERNETCLIENT_W5100_LAST_ACK 0x1D
 
+#ifndef ETHERNETCLIENT_RX_BUFFER_SIZE
+#define ETHERNETCLIENT_RX_BUFFER_SIZE 1024 //!< Size of the receive buffer.
+#endif
+
+#define ETHERNETCLIENT_LINE_NONE -1 //!< readLine(): no complete line received yet.
+#define ETHERNETCLIENT_LINE_TOO_LONG -2 //!< readLine(): line did not fit and was discarded.
+
 /**
  * EthernetClient class
  */
@@ -126,6 +133,24 @@ public:
 	 * @return -1 if no data, else the first byte of incoming data available.
 	 */
 	virtual int peek();
+	/**
+	 * @brief Read a line terminated by '\\n' or '\\r'.
+	 *
+	 * Partial lines stay in the receive buffer until they are complete.
+	 *
+	 * @param buffer to write the null-terminated line to, without terminator.
+	 * @param length of the buffer.
+	 * @return line length, ETHERNETCLIENT_LINE_NONE if no complete line is available or
+	 * ETHERNETCLIENT_LINE_TOO_LONG if a line did not fit. Such a line is discarded up to
+	 * and including its terminator.
+	 */
+	int readLine(char *buffer, size_t length);
+	/**
+	 * @brief Check for a complete line in the receive buffer, without reading the socket.
+	 *
+	 * @return @c true if a line terminator is buffered.
+	 */
+	bool hasLine();
 	/**
 	 * @brief Waits until all outgoing bytes in buffer have been sent.
 	 */
@@ -206,6 +231,29 @@ public:
 private:
 	int _sock; //!< @brief Network socket file descriptor.
 	IPAddress _srcip; //!< @brief Local ip to bind to.
+	uint8_t _rxBuffer[ETHERNETCLIENT_RX_BUFFER_SIZE]; //!< @brief Receive buffer.
+	uint16_t _rxStart; //!< @brief Index of the first unread byte in _rxBuffer.
+	uint16_t _rxEnd; //!< @brief Index past the last received byte in _rxBuffer.
+	bool _rxDiscard; //!< @brief Dropping a line that was too long, up to its terminator.
+
+	/**
+	 * @brief Receive as much as fits into the receive buffer, with a single recv().
+	 *
+	 * @return number of bytes received, 0 on EOF or full buffer, -1 if no data.
+	 */
+	int _fill();
+	/**
+	 * @brief Find the first line terminator in the receive buffer.
+	 *
+	 * @return pointer to the terminator or NULL.
+	 */
+	const uint8_t *_findEol();
+	/**
+	 * @brief Consume bytes from the receive buffer.
+	 *
+	 * @param bytes number of bytes to consume.
+	 */
+	void _consume(size_t bytes);
 };
 
 #endif
@@ -29,13 +29,34 @@
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <time.h>
 #include "log.h"
+#include "eventloop.h"
 #include "EthernetClient.h"
 
+#define ETHERNETSERVER_MAX_EVENTS 64 //!< Events collected per hasClient() call.
+#define ETHERNETSERVER_LISTENER UINT32_MAX //!< epoll tag of the listening socket.
+#define ETHERNETSERVER_MAX_IOV 16 //!< Queued writes sent per sendmsg() call.
+
+static uint32_t monotonicMs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
 EthernetServer::EthernetServer(uint16_t port, uint16_t max_clients) : port(port),
-	max_clients(max_clients), sockfd(-1)
+	max_clients(max_clients), sockfd(-1), epollfd(-1), slots(max_clients, -1),
+	ready(max_clients, false), tx_queues(max_clients), tx_queue_size(ETHERNETSERVER_TX_QUEUE_SIZE),
+	slow_client_policy(ETHERNETSERVER_SLOW_CLIENT_DROP_OLDEST)
 {
-	clients.reserve(max_clients);
+	free_slots.reserve(max_clients);
+	// Hand out the lowest slots first
+	for (uint16_t i = max_clients; i > 0; i--) {
+		free_slots.push_back(i - 1);
+	}
 }
 
 void EthernetServer::begin()
@@ -46,12 +67,14 @@ void EthernetServer::begin()
 void EthernetServer::begin(IPAddress address)
 {
 	struct addrinfo hints, *servinfo, *p;
+	struct epoll_event ev;
 	int yes=1;
 	int rv;
 	char ipstr[INET_ADDRSTRLEN];
 	char portstr[6];
 
 	if (sockfd != -1) {
+		// Also removes it from epollfd
 		close(sockfd);
 		sockfd = -1;
 	}
@@ -95,56 +118,144 @@ void EthernetServer::begin(IPAddress address)
 		return;
 	}
 
-	if (listen(sockfd, ETHERNETSERVER_BACKLOG) == -1) {
+	if (listen(sockfd, max_clients > ETHERNETSERVER_BACKLOG ? max_clients : ETHERNETSERVER_BACKLOG) == -1) {
 		logError("listen: %s\n", strerror(errno));
 		freeaddrinfo(servinfo);
 		return;
 	}
 
+	struct sockaddr_in *ipv4 = (struct sockaddr_in *)p->ai_addr;
+	void *addr = &(ipv4->sin_addr);
+	inet_ntop(p->ai_family, addr, ipstr, sizeof ipstr);
 	freeaddrinfo(servinfo);
 
 	fcntl(sockfd, F_SETFL, O_NONBLOCK);
 
-	struct sockaddr_in *ipv4 = (struct sockaddr_in *)p->ai_addr;
-	void *addr = &(ipv4->sin_addr);
-	inet_ntop(p->ai_family, addr, ipstr, sizeof ipstr);
+	// Clients are watched here, the event loop only sees this epoll instance
+	if (epollfd == -1) {
+		if ((epollfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+			logError("epoll_create1: %s\n", strerror(errno));
+			return;
+		}
+		eventLoopAdd(epollfd);
+	}
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u32 = ETHERNETSERVER_LISTENER;
+	if (epoll_ctl(epollfd, EPOLL_CTL_ADD, sockfd, &ev) == -1) {
+		logError("epoll_ctl: %s\n", strerror(errno));
+		return;
+	}
+
 	logDebug("Listening for connections on %s:%s\n", ipstr, portstr);
 }
 
 bool EthernetServer::hasClient()
 {
-	// Check if any client has disconnected
-	for (size_t i = 0; i < clients.size(); ++i) {
-		EthernetClient client(clients[i]);
-		if (!client.connected()) {
-			// Checks if this disconnected client is also on the new clients list
-			for (std::list<int>::iterator it = new_clients.begin(); it != new_clients.end(); ++it) {
-				if (*it == clients[i]) {
-					new_clients.erase(it);
-					break;
-				}
-			}
-			client.stop();
-			clients[i] = clients.back();
-			clients.pop_back();
-			logDebug("Ethernet client disconnected.\n");
-		}
+	struct epoll_event events[ETHERNETSERVER_MAX_EVENTS];
+	int n;
+
+	if (epollfd == -1) {
+		return !new_clients.empty();
 	}
 
-	_accept();
+	// Only what is ready is looked at, idle clients cost nothing
+	do {
+		n = epoll_wait(epollfd, events, ETHERNETSERVER_MAX_EVENTS, 0);
+	} while (n == -1 && errno == EINTR);
+	if (n == -1) {
+		logError("epoll_wait: %s\n", strerror(errno));
+		return !new_clients.empty();
+	}
+
+	for (int i = 0; i < n; i++) {
+		if (events[i].data.u32 == ETHERNETSERVER_LISTENER) {
+			_accept();
+			continue;
+		}
+		const uint16_t slot = events[i].data.u32;
+		if (events[i].events & EPOLLOUT) {
+			_flush(slot);
+		}
+		if ((events[i].events & ~EPOLLOUT) && !ready[slot]) {
+			ready[slot] = true;
+			ready_clients.push_back(slot);
+		}
+	}
 
 	return !new_clients.empty();
 }
 
 EthernetClient EthernetServer::available()
+{
+	uint16_t slot;
+	return available(slot);
+}
+
+EthernetClient EthernetServer::available(uint16_t &slot)
 {
 	if (new_clients.empty()) {
 		return EthernetClient();
-	} else {
-		int sock = new_clients.front();
-		new_clients.pop_front();
-		return EthernetClient(sock);
 	}
+
+	slot = new_clients.front();
+	new_clients.pop_front();
+	return EthernetClient(slots[slot]);
+}
+
+int EthernetServer::readyClient()
+{
+	while (!ready_clients.empty()) {
+		const uint16_t slot = ready_clients.front();
+		ready_clients.pop_front();
+		ready[slot] = false;
+		if (slots[slot] != -1) {
+			return slot;
+		}
+	}
+
+	return -1;
+}
+
+void EthernetServer::requeueClient(uint16_t slot)
+{
+	if (slot >= max_clients || slots[slot] == -1 || ready[slot]) {
+		return;
+	}
+	ready[slot] = true;
+	ready_clients.push_back(slot);
+}
+
+void EthernetServer::release(uint16_t slot)
+{
+	if (slot >= max_clients || slots[slot] == -1) {
+		return;
+	}
+	// Closing the socket already removed it from epollfd
+	slots[slot] = -1;
+	free_slots.push_back(slot);
+	_resetTxQueue(slot);
+}
+
+void EthernetServer::setTxQueue(size_t size, uint8_t policy)
+{
+	tx_queue_size = size;
+	slow_client_policy = policy;
+}
+
+bool EthernetServer::clientStats(uint16_t slot, EthernetServerClientStats &stats)
+{
+	if (slot >= max_clients || slots[slot] == -1) {
+		return false;
+	}
+
+	const TxQueue &queue = tx_queues[slot];
+	stats.queuedBytes = queue.bytes;
+	stats.queuedMessages = queue.messages.size();
+	stats.maxQueuedBytes = queue.maxBytes;
+	stats.dropped = queue.dropped;
+	stats.lagMs = queue.messages.empty() ? 0 : monotonicMs() - queue.messages.front().queuedAt;
+	return true;
 }
 
 size_t EthernetServer::write(uint8_t b)
@@ -156,10 +267,10 @@ size_t EthernetServer::write(const uint8_t *buffer, size_t size)
 {
 	size_t n = 0;
 
-	for (size_t i = 0; i < clients.size(); ++i) {
-		EthernetClient client(clients[i]);
-		if (client.status() == ETHERNETCLIENT_W5100_ESTABLISHED) {
-			n += client.write(buffer, size);
+	// A slow client only grows its own queue, the others are not held up
+	for (uint16_t i = 0; i < max_clients; ++i) {
+		if (slots[i] != -1 && _send(i, buffer, size)) {
+			n += size;
 		}
 	}
 
@@ -181,31 +292,209 @@ size_t EthernetServer::write(const char *buffer, size_t size)
 
 void EthernetServer::_accept()
 {
+	struct epoll_event ev;
 	int new_fd;
 	socklen_t sin_size;
 	struct sockaddr_storage client_addr;
 	char ipstr[INET_ADDRSTRLEN];
 
-	sin_size = sizeof client_addr;
-	new_fd = accept(sockfd, (struct sockaddr *)&client_addr, &sin_size);
-	if (new_fd == -1) {
-		if (errno != EAGAIN && errno != EWOULDBLOCK) {
-			logError("accept: %s\n", strerror(errno));
+	while (true) {
+		sin_size = sizeof client_addr;
+		new_fd = ::accept(sockfd, (struct sockaddr *)&client_addr, &sin_size);
+		if (new_fd == -1) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				logError("accept: %s\n", strerror(errno));
+			}
+			return;
+		}
+
+		if (free_slots.empty()) {
+			close(new_fd);
+			logDebug("Max number of ethernet clients reached.\n");
+			continue;
+		}
+
+		const uint16_t slot = free_slots.back();
+		_resetTxQueue(slot);
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN | EPOLLRDHUP;
+		ev.data.u32 = slot;
+		if (epoll_ctl(epollfd, EPOLL_CTL_ADD, new_fd, &ev) == -1) {
+			logError("epoll_ctl: %s\n", strerror(errno));
+			close(new_fd);
+			continue;
+		}
+		free_slots.pop_back();
+		slots[slot] = new_fd;
+		new_clients.push_back(slot);
+
+		void *addr = &(((struct sockaddr_in*)&client_addr)->sin_addr);
+		inet_ntop(client_addr.ss_family, addr, ipstr, sizeof ipstr);
+		logDebug("New connection from %s\n", ipstr);
+	}
+}
+
+bool EthernetServer::_send(uint16_t slot, const uint8_t *buffer, size_t size)
+{
+	TxQueue &queue = tx_queues[slot];
+	size_t sent = 0;
+
+	if (queue.closing) {
+		return false;
+	}
+	if (queue.messages.empty()) {
+		// Nothing queued ahead, try to send right away
+		const ssize_t rc = send(slots[slot], buffer, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (rc == (ssize_t)size) {
+			return true;
+		}
+		if (rc > 0) {
+			sent = rc;
+		} else if (rc == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			logError("send: %s\n", strerror(errno));
+			_disconnect(slot);
+			return false;
+		}
+	}
+
+	const size_t length = size - sent;
+	// A partly sent write has to be completed, the queue is empty then anyway
+	if (sent == 0 && queue.bytes + length > tx_queue_size) {
+		if (slow_client_policy == ETHERNETSERVER_SLOW_CLIENT_DISCONNECT) {
+			logNotice("Ethernet client %d too slow, disconnecting.\n", slot);
+			queue.dropped++;
+			_disconnect(slot);
+			return false;
+		}
+		if (!queue.lagging) {
+			queue.lagging = true;
+			logNotice("Ethernet client %d too slow, dropping messages.\n", slot);
+		}
+		// Drop the oldest writes, except one that is partly sent
+		std::deque<TxMessage>::iterator oldest = queue.messages.begin();
+		if (queue.offset > 0) {
+			++oldest;
+		}
+		while (queue.bytes + length > tx_queue_size && oldest != queue.messages.end()) {
+			queue.bytes -= oldest->data.size();
+			oldest = queue.messages.erase(oldest);
+			queue.dropped++;
+		}
+		if (queue.bytes + length > tx_queue_size) {
+			queue.dropped++;
+			return false;
+		}
+	}
+
+	queue.messages.push_back(TxMessage());
+	TxMessage &message = queue.messages.back();
+	message.data.assign(buffer + sent, buffer + size);
+	message.queuedAt = monotonicMs();
+	queue.bytes += length;
+	if (queue.bytes > queue.maxBytes) {
+		queue.maxBytes = queue.bytes;
+	}
+	_updatePollOut(slot);
+
+	return true;
+}
+
+void EthernetServer::_flush(uint16_t slot)
+{
+	TxQueue &queue = tx_queues[slot];
+	struct iovec iov[ETHERNETSERVER_MAX_IOV];
+	struct msghdr msg;
+
+	while (!queue.messages.empty()) {
+		size_t count = 0;
+		for (std::deque<TxMessage>::iterator it = queue.messages.begin();
+		        it != queue.messages.end() && count < ETHERNETSERVER_MAX_IOV; ++it, ++count) {
+			const size_t skip = count == 0 ? queue.offset : 0;
+			iov[count].iov_base = &it->data[skip];
+			iov[count].iov_len = it->data.size() - skip;
+		}
+
+		// writev() with flags, a dead peer must not raise SIGPIPE
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		const ssize_t rc = sendmsg(slots[slot], &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (rc == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				logError("sendmsg: %s\n", strerror(errno));
+				_disconnect(slot);
+				return;
+			}
+			break;
+		}
+
+		queue.bytes -= rc;
+		size_t done = rc;
+		while (done > 0) {
+			const size_t left = queue.messages.front().data.size() - queue.offset;
+			if (done < left) {
+				queue.offset += done;
+				break;
+			}
+			done -= left;
+			queue.offset = 0;
+			queue.messages.pop_front();
 		}
+	}
+
+	if (queue.messages.empty()) {
+		queue.lagging = false;
+	}
+	_updatePollOut(slot);
+}
+
+void EthernetServer::_updatePollOut(uint16_t slot)
+{
+	TxQueue &queue = tx_queues[slot];
+	struct epoll_event ev;
+	const bool pollOut = !queue.messages.empty();
+
+	if (pollOut == queue.pollOut || slots[slot] == -1) {
 		return;
 	}
 
-	if (clients.size() == max_clients) {
-		// no free slots, search for a dead client
-		close(new_fd);
-		logDebug("Max number of ethernet clients reached.\n");
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLRDHUP | (pollOut ? (uint32_t)EPOLLOUT : 0u);
+	ev.data.u32 = slot;
+	if (epoll_ctl(epollfd, EPOLL_CTL_MOD, slots[slot], &ev) == -1) {
+		logError("epoll_ctl: %s\n", strerror(errno));
 		return;
 	}
+	queue.pollOut = pollOut;
+}
+
+void EthernetServer::_disconnect(uint16_t slot)
+{
+	TxQueue &queue = tx_queues[slot];
 
-	new_clients.push_back(new_fd);
-	clients.push_back(new_fd);
+	// The socket stays open until the caller sees the hang-up and releases the slot
+	shutdown(slots[slot], SHUT_RDWR);
+	queue.closing = true;
+	queue.messages.clear();
+	queue.offset = 0;
+	queue.bytes = 0;
+	queue.lagging = false;
+	_updatePollOut(slot);
+}
+
+void EthernetServer::_resetTxQueue(uint16_t slot)
+{
+	TxQueue &queue = tx_queues[slot];
 
-	void *addr = &(((struct sockaddr_in*)&client_addr)->sin_addr);
-	inet_ntop(client_addr.ss_family, addr, ipstr, sizeof ipstr);
-	logDebug("New connection from %s\n", ipstr);
+	queue.messages.clear();
+	queue.offset = 0;
+	queue.bytes = 0;
+	queue.maxBytes = 0;
+	queue.dropped = 0;
+	queue.pollOut = false;
+	queue.lagging = false;
+	queue.closing = false;
 }
@@ -22,7 +22,7 @@
 #ifndef EthernetServer_h
 #define EthernetServer_h
 
-#include <list>
+#include <deque>
 #include <vector>
 #include "Server.h"
 #include "IPAddress.h"
@@ -34,8 +34,24 @@
 #define ETHERNETSERVER_BACKLOG 10 //!< Maximum length to which the queue of pending connections may grow.
 #endif
 
+#define ETHERNETSERVER_TX_QUEUE_SIZE 8192 //!< Default limit of bytes queued for a slow client.
+
+#define ETHERNETSERVER_SLOW_CLIENT_DROP_OLDEST 0 //!< Slow client policy: drop its oldest queued messages.
+#define ETHERNETSERVER_SLOW_CLIENT_DISCONNECT 1 //!< Slow client policy: disconnect it.
+
 class EthernetClient;
 
+/**
+ * @brief Outbound queue statistics of a client.
+ */
+struct EthernetServerClientStats {
+	uint32_t queuedBytes; //!< Bytes waiting to be sent.
+	uint32_t queuedMessages; //!< Writes waiting to be sent, complete or partial.
+	uint32_t maxQueuedBytes; //!< Highest queuedBytes since the client connected.
+	uint32_t dropped; //!< Writes dropped by the slow client policy.
+	uint32_t lagMs; //!< Age of the oldest queued write, 0 if the queue is empty.
+};
+
 /**
  * @brief EthernetServer class
  */
@@ -64,6 +80,8 @@ public:
 	/**
 	 * @brief Verifies if a new client has connected.
 	 *
+	 * Also collects the clients with pending input or a hang-up, see readyClient().
+	 *
 	 * @return @c true if a new client has connected, else @c false.
 	 */
 	bool hasClient();
@@ -73,6 +91,53 @@ public:
 	 * @return a EthernetClient object; if no new client has connected, this object will evaluate to false.
 	 */
 	EthernetClient available();
+	/**
+	 * @brief Get the new connected client and its slot.
+	 *
+	 * @param slot set to the slot of the client, below max_clients.
+	 * @return a EthernetClient object; if no new client has connected, this object will evaluate to false.
+	 */
+	EthernetClient available(uint16_t &slot);
+	/**
+	 * @brief Get the next client with pending input or a hang-up.
+	 *
+	 * Each event is reported once per hasClient() call.
+	 *
+	 * @return slot of the client, or -1 if there is none.
+	 */
+	int readyClient();
+	/**
+	 * @brief Report a client through readyClient() again, e.g. for input it has buffered.
+	 *
+	 * epoll only sees the socket, not lines already read into the client's buffer.
+	 *
+	 * @param slot of the client.
+	 */
+	void requeueClient(uint16_t slot);
+	/**
+	 * @brief Free the slot of a client the caller has closed.
+	 *
+	 * @param slot of the client.
+	 */
+	void release(uint16_t slot);
+	/**
+	 * @brief Configure the outbound queues.
+	 *
+	 * Writes are never blocking, whatever a client does not accept right away is queued
+	 * up to size bytes. A client that exceeds this is handled according to policy.
+	 *
+	 * @param size limit of bytes queued per client.
+	 * @param policy ETHERNETSERVER_SLOW_CLIENT_DROP_OLDEST or ETHERNETSERVER_SLOW_CLIENT_DISCONNECT.
+	 */
+	void setTxQueue(size_t size, uint8_t policy);
+	/**
+	 * @brief Get the outbound queue statistics of a client.
+	 *
+	 * @param slot of the client.
+	 * @param stats to fill in.
+	 * @return @c false if the slot is not in use.
+	 */
+	bool clientStats(uint16_t slot, EthernetServerClientStats &stats);
 	/**
 	 * @brief Write a byte to all clients.
 	 *
@@ -105,17 +170,78 @@ public:
 	size_t write(const char *buffer, size_t size);
 
 private:
+	/**
+	 * @brief A queued write.
+	 */
+	struct TxMessage {
+		std::vector<uint8_t> data; //!< @brief Unsent bytes.
+		uint32_t queuedAt; //!< @brief Time of queueing, monotonic ms.
+	};
+	/**
+	 * @brief Outbound queue of a client.
+	 */
+	struct TxQueue {
+		std::deque<TxMessage> messages; //!< @brief Queued writes, oldest first.
+		size_t offset; //!< @brief Bytes of the first write already sent.
+		size_t bytes; //!< @brief Unsent bytes in messages.
+		size_t maxBytes; //!< @brief Highest bytes since the client connected.
+		uint32_t dropped; //!< @brief Writes dropped by the slow client policy.
+		bool pollOut; //!< @brief EPOLLOUT is requested for the client.
+		bool lagging; //!< @brief Drops were logged since the queue last drained.
+		bool closing; //!< @brief Disconnected by the slow client policy or an error.
+	};
+
 	uint16_t port; //!< @brief Port number for the network socket.
-	std::list<int> new_clients; //!< Socket list of new connected clients.
-	std::vector<int> clients; //!< @brief Socket list of connected clients.
 	uint16_t max_clients; //!< @brief The maximum number of allowed clients.
 	int sockfd; //!< @brief Network socket used to accept connections.
+	int epollfd; //!< @brief Watches the listening socket and all clients.
+	std::vector<int> slots; //!< @brief Socket of each client slot, -1 if the slot is free.
+	std::vector<bool> ready; //!< @brief Slots already queued in ready_clients.
+	std::vector<uint16_t> free_slots; //!< @brief Stack of free slots.
+	std::deque<uint16_t> new_clients; //!< @brief Slots of new connected clients.
+	std::deque<uint16_t> ready_clients; //!< @brief Slots with pending input or a hang-up.
+	std::vector<TxQueue> tx_queues; //!< @brief Outbound queue of each slot.
+	size_t tx_queue_size; //!< @brief Limit of bytes queued per client.
+	uint8_t slow_client_policy; //!< @brief What to do with a client whose queue is full.
 
 	/**
-	 * @brief Accept new clients if the total of connected clients is below max_clients.
+	 * @brief Accept new clients while there are free slots.
 	 *
 	 */
 	void _accept();
+	/**
+	 * @brief Send or queue a write to a client.
+	 *
+	 * @param slot of the client.
+	 * @param buffer to send.
+	 * @param size of the buffer.
+	 * @return @c true if the write was sent or queued.
+	 */
+	bool _send(uint16_t slot, const uint8_t *buffer, size_t size);
+	/**
+	 * @brief Send as much of a client's queue as the socket accepts.
+	 *
+	 * @param slot of the client.
+	 */
+	void _flush(uint16_t slot);
+	/**
+	 * @brief Request EPOLLOUT for a client while its queue is not empty.
+	 *
+	 * @param slot of the client.
+	 */
+	void _updatePollOut(uint16_t slot);
+	/**
+	 * @brief Disconnect a client, the caller sees a hang-up through readyClient().
+	 *
+	 * @param slot of the client.
+	 */
+	void _disconnect(uint16_t slot);
+	/**
+	 * @brief Empty a client's queue and reset its statistics.
+	 *
+	 * @param slot of the client.
+	 */
+	void _resetTxQueue(uint16_t slot);
 };
 
 #endif
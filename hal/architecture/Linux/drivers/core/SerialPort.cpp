@@ -19,6 +19,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
@@ -29,11 +30,14 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include "log.h"
+#include "eventloop.h"
 #include "SerialPort.h"
 
 SerialPort::SerialPort(const char *port, bool isPty) : serialPort(std::string(port)), isPty(isPty)
 {
 	sd = -1;
+	ptySlave = -1;
+	rxStart = rxEnd = 0;
 }
 
 void SerialPort::begin(int bauds)
@@ -42,6 +46,7 @@ void SerialPort::begin(int bauds)
 		logError("Failed to open serial port.\n");
 		exit(1);
 	}
+	eventLoopAdd(sd);
 	logDebug("Serial port %s (%d baud) created\n", serialPort.c_str(), bauds);
 }
 
@@ -74,6 +79,12 @@ bool SerialPort::open(int bauds)
 			         strerror(errno));
 			return false;
 		}
+
+		/* keep the slave side open, the master reports a hangup as long as no slave is open */
+		if (ptySlave == -1 && (ptySlave = ::open(ptsname(sd), O_RDWR | O_NOCTTY)) == -1) {
+			logError("Couldn't open the PTY slave: %s\n", strerror(errno));
+			return false;
+		}
 	} else {
 		if ((sd = ::open(serialPort.c_str(), O_RDWR | O_NOCTTY | O_NDELAY)) == -1) {
 			logError("Unable to open the serial port %s\n", serialPort.c_str());
@@ -215,56 +226,104 @@ bool SerialPort::setGroupPerm(const char *groupName)
 
 int SerialPort::available()
 {
-	int nbytes = 0;
-
-	if (ioctl(sd, FIONREAD, &nbytes) < 0) {
-		logError("Failed to get byte count on serial.\n");
-		exit(-1);
+	if (rxStart == rxEnd) {
+		fill();
 	}
-	return nbytes;
+
+	return rxEnd - rxStart;
 }
 
 int SerialPort::read()
 {
-	unsigned char c;
+	if (!available()) {
+		return -1;
+	}
 
-	int ret = ::read(sd, &c, 1);
-	if (ret < 0) {
-		logError("Serial - read failed: %s\n", strerror(errno));
-	} else if (ret == 1) {
-		return c;
+	unsigned char c = rxBuffer[rxStart];
+	consume(1);
+	return c;
+}
+
+int SerialPort::read(uint8_t *buffer, size_t size)
+{
+	if (!available()) {
+		return -1;
 	}
 
-	return -1;
+	size_t n = rxEnd - rxStart;
+	if (n > size) {
+		n = size;
+	}
+	memcpy(buffer, rxBuffer + rxStart, n);
+	consume(n);
+	return n;
 }
 
-size_t SerialPort::write(uint8_t b)
+int SerialPort::readLine(char *buffer, size_t length)
 {
-	int ret = ::write(sd, &b, 1);
-	if (ret < 0) {
-		logError("Serial - write failed: %s\n", strerror(errno));
+	const uint8_t *eol = findEol();
+
+	if (eol == NULL && fill() > 0) {
+		eol = findEol();
 	}
-	return ret;
+
+	if (eol == NULL) {
+		if ((size_t)(rxEnd - rxStart) < length - 1) {
+			// Wait for the rest of the line
+			return SERIALPORT_LINE_NONE;
+		}
+		consume(length - 1);
+		return SERIALPORT_LINE_TOO_LONG;
+	}
+
+	size_t n = eol - (rxBuffer + rxStart);
+	if (n > length - 1) {
+		consume(length - 1);
+		return SERIALPORT_LINE_TOO_LONG;
+	}
+	memcpy(buffer, rxBuffer + rxStart, n);
+	buffer[n] = 0;
+	// Skip the terminator, but do not flag a partial line as pending
+	rxStart += n + 1;
+	if (rxStart == rxEnd) {
+		rxStart = rxEnd = 0;
+	} else if (findEol() != NULL) {
+		eventLoopPending();
+	}
+
+	return n;
+}
+
+size_t SerialPort::write(uint8_t b)
+{
+	return write(&b, 1);
 }
 
 size_t SerialPort::write(const uint8_t *buffer, size_t size)
 {
-	int ret = ::write(sd, buffer, size);
-	if (ret < 0) {
-		logError("Serial - write failed: %s\n", strerror(errno));
+	size_t written = 0;
+
+	while (written < size) {
+		ssize_t ret = ::write(sd, buffer + written, size - written);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			logError("Serial - write failed: %s\n", strerror(errno));
+			break;
+		}
+		written += ret;
 	}
-	return ret;
+	return written;
 }
 
 int SerialPort::peek()
 {
-	FILE * f = fdopen(sd, "r+");
-	int c = getc(f);
-	if (c == EOF) {
+	if (!available()) {
 		return -1;
 	}
-	ungetc(c, f);
-	return c;
+
+	return rxBuffer[rxStart];
 }
 
 void SerialPort::flush()
@@ -275,9 +334,69 @@ void SerialPort::flush()
 	}
 }
 
+int SerialPort::fill()
+{
+	if (rxStart == rxEnd) {
+		rxStart = rxEnd = 0;
+	} else if (rxStart > 0 && rxEnd == sizeof(rxBuffer)) {
+		// Make room at the end
+		memmove(rxBuffer, rxBuffer + rxStart, rxEnd - rxStart);
+		rxEnd -= rxStart;
+		rxStart = 0;
+	}
+
+	if (rxEnd == sizeof(rxBuffer)) {
+		return 0;
+	}
+
+	ssize_t ret = ::read(sd, rxBuffer + rxEnd, sizeof(rxBuffer) - rxEnd);
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EINTR) {
+			return 0;
+		}
+		logError("Serial - read failed: %s\n", strerror(errno));
+		return -1;
+	}
+	rxEnd += ret;
+
+	return ret;
+}
+
+const uint8_t *SerialPort::findEol()
+{
+	const uint8_t *start = rxBuffer + rxStart;
+	size_t n = rxEnd - rxStart;
+
+	const uint8_t *eol = (const uint8_t *)memchr(start, '\n', n);
+	if (eol != NULL) {
+		n = eol - start;
+	}
+	const uint8_t *cr = (const uint8_t *)memchr(start, '\r', n);
+
+	return cr != NULL ? cr : eol;
+}
+
+void SerialPort::consume(size_t bytes)
+{
+	rxStart += bytes;
+	if (rxStart == rxEnd) {
+		rxStart = rxEnd = 0;
+	} else {
+		// epoll does not see buffered data, keep the loop awake
+		eventLoopPending();
+	}
+}
+
 void SerialPort::end()
 {
+	eventLoopRemove(sd);
 	close(sd);
+	rxStart = rxEnd = 0;
+
+	if (ptySlave != -1) {
+		close(ptySlave);
+		ptySlave = -1;
+	}
 
 	if (isPty) {
 		unlink(serialPort.c_str());	// remove the symlink
@@ -24,6 +24,13 @@
 #include <stdbool.h>
 #include "Stream.h"
 
+#ifndef SERIALPORT_RX_BUFFER_SIZE
+#define SERIALPORT_RX_BUFFER_SIZE 1024 //!< Size of the receive buffer.
+#endif
+
+#define SERIALPORT_LINE_NONE -1 //!< readLine(): no complete line received yet.
+#define SERIALPORT_LINE_TOO_LONG -2 //!< readLine(): line did not fit and was discarded.
+
 /**
  * SerialPort Class
  * Class that provides the functionality of arduino Serial library
@@ -35,6 +42,29 @@ private:
 	int sd; //!< @brief file descriptor number.
 	std::string serialPort;	//!< @brief tty name.
 	bool isPty; //!< @brief true if serial is pseudo terminal.
+	int ptySlave; //!< @brief file descriptor of the PTY slave side, kept open to avoid hangups.
+	uint8_t rxBuffer[SERIALPORT_RX_BUFFER_SIZE]; //!< @brief Receive buffer.
+	uint16_t rxStart; //!< @brief Index of the first unread byte in rxBuffer.
+	uint16_t rxEnd; //!< @brief Index past the last received byte in rxBuffer.
+
+	/**
+	 * @brief Read as much as fits into the receive buffer, with a single read().
+	 *
+	 * @return number of bytes read, 0 if no data or full buffer, -1 on error.
+	 */
+	int fill();
+	/**
+	 * @brief Find the first line terminator in the receive buffer.
+	 *
+	 * @return pointer to the terminator or NULL.
+	 */
+	const uint8_t *findEol();
+	/**
+	 * @brief Consume bytes from the receive buffer.
+	 *
+	 * @param bytes number of bytes to consume.
+	 */
+	void consume(size_t bytes);
 
 public:
 	/**
@@ -78,6 +108,25 @@ public:
 	*/
 	int read();
 	/**
+	* @brief Reads up to size bytes of incoming serial data.
+	*
+	* @param buffer to read into.
+	* @param size of the buffer.
+	* @return number of bytes read, -1 if no data available.
+	*/
+	int read(uint8_t *buffer, size_t size);
+	/**
+	* @brief Read a line terminated by '\\n' or '\\r'.
+	*
+	* Partial lines stay in the receive buffer until they are complete.
+	*
+	* @param buffer to write the null-terminated line to, without terminator.
+	* @param length of the buffer.
+	* @return line length, SERIALPORT_LINE_NONE if no complete line is available or
+	* SERIALPORT_LINE_TOO_LONG if length - 1 characters were discarded.
+	*/
+	int readLine(char *buffer, size_t length);
+	/**
 	* @brief Writes a single byte to the serial port.
 	*
 	* @param b byte to write.
@@ -87,6 +136,8 @@ public:
 	/**
 	* @brief Writes binary data to the serial port.
 	*
+	* Short writes are retried, so a whole frame goes out in as few write() calls as possible.
+	*
 	* @param buffer to write.
 	* @param size of the buffer.
 	* @return number of bytes written.
@@ -96,7 +147,7 @@ public:
 	* @brief
 	*
 	* Returns the next byte (character) of incoming serial data without removing it from
-	* the internal serial buffer.
+	* the receive buffer.
 	*
 	* @return -1 if no data else character in the buffer.
 	*/
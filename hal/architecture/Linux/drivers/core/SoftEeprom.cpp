@@ -18,15 +18,141 @@
  */
 
 #include <stdlib.h>
-#include <iostream>
-#include <fstream>
+#include <stdio.h>
+#include <string>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
 #include <string.h>
 #include <errno.h>
 #include "log.h"
 #include "SoftEeprom.h"
 
-SoftEeprom::SoftEeprom() : _length(0), _fileName(NULL), _values(NULL)
+// The file holds nothing but the eeprom values, so that any version can read it. Their
+// checksum goes to a separate file, together with the data file's mtime and size at
+// the time the checksum was taken.
+#define SOFTEEPROM_MAGIC 0x4545594Dul //!< "MYEE"
+#define SOFTEEPROM_CHECKSUM_SUFFIX ".crc" //!< Appended to the eeprom file name.
+
+/**
+ * Contents of the checksum file.
+ */
+struct softEepromChecksum {
+	uint32_t magic; //!< SOFTEEPROM_MAGIC
+	uint32_t crc; //!< CRC-32 of the values
+	int64_t mtimeSec; //!< Data file mtime, seconds
+	int64_t mtimeNsec; //!< Data file mtime, nanoseconds
+	uint64_t size; //!< Data file size
+};
+
+static uint32_t monotonicMs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static uint32_t crc32(const uint8_t *data, size_t length)
+{
+	uint32_t crc = 0xFFFFFFFFul;
+
+	while (length--) {
+		crc ^= *data++;
+		for (uint8_t i = 0; i < 8; i++) {
+			crc = (crc >> 1) ^ (0xEDB88320ul & (0 - (crc & 1)));
+		}
+	}
+
+	return ~crc;
+}
+
+static int readAll(int fd, void *buf, size_t length)
+{
+	uint8_t *p = (uint8_t *)buf;
+
+	while (length > 0) {
+		const ssize_t rc = read(fd, p, length);
+		if (rc == -1 && errno == EINTR) {
+			continue;
+		}
+		if (rc <= 0) {
+			return -1;
+		}
+		p += rc;
+		length -= rc;
+	}
+
+	return 0;
+}
+
+static int writeAll(int fd, struct iovec *iov, int count)
+{
+	while (count > 0) {
+		ssize_t rc = writev(fd, iov, count);
+		if (rc == -1 && errno == EINTR) {
+			continue;
+		}
+		if (rc <= 0) {
+			return -1;
+		}
+		while (count > 0 && (size_t)rc >= iov->iov_len) {
+			rc -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0) {
+			iov->iov_base = (uint8_t *)iov->iov_base + rc;
+			iov->iov_len -= rc;
+		}
+	}
+
+	return 0;
+}
+
+// Writes a complete new file and renames it over the old one. On success, info is
+// the new file's status.
+static int replaceFile(const char *fileName, struct iovec *iov, int count, struct stat *info)
+{
+	struct stat fileInfo;
+	int fd;
+
+	const std::string tmpName = std::string(fileName) + ".tmp";
+	if ((fd = open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)) == -1) {
+		logError("Unable to write config to file %s: %s\n", tmpName.c_str(), strerror(errno));
+		return -1;
+	}
+	if (stat(fileName, &fileInfo) == 0) {
+		(void)fchmod(fd, fileInfo.st_mode & 07777);
+	}
+
+	if (writeAll(fd, iov, count) != 0 || fsync(fd) != 0 || fstat(fd, info) != 0) {
+		logError("Unable to write config to file %s: %s\n", tmpName.c_str(), strerror(errno));
+		close(fd);
+		unlink(tmpName.c_str());
+		return -1;
+	}
+	close(fd);
+
+	if (rename(tmpName.c_str(), fileName) != 0) {
+		logError("Unable to write config to file %s: %s\n", fileName, strerror(errno));
+		unlink(tmpName.c_str());
+		return -1;
+	}
+
+	return 0;
+}
+
+static bool checksumMatchesFile(const struct softEepromChecksum *checksum, const struct stat *info)
+{
+	return checksum->mtimeSec == (int64_t)info->st_mtim.tv_sec &&
+	       checksum->mtimeNsec == (int64_t)info->st_mtim.tv_nsec &&
+	       checksum->size == (uint64_t)info->st_size;
+}
+
+SoftEeprom::SoftEeprom() : _length(0), _fileName(NULL), _values(NULL), _dirty(false),
+	_dirtySince(0), _flushDelay(0)
 {
 }
 
@@ -39,6 +165,9 @@ SoftEeprom::SoftEeprom(const SoftEeprom& other)
 	for (size_t i = 0; i < _length; ++i) {
 		_values[i] = other._values[i];
 	}
+	_dirty = other._dirty;
+	_dirtySince = other._dirtySince;
+	_flushDelay = other._flushDelay;
 }
 
 SoftEeprom::~SoftEeprom()
@@ -49,6 +178,8 @@ SoftEeprom::~SoftEeprom()
 int SoftEeprom::init(const char *fileName, size_t length)
 {
 	struct stat fileInfo;
+	struct softEepromChecksum checksum;
+	int fd;
 
 	destroy();
 
@@ -64,31 +195,55 @@ int SoftEeprom::init(const char *fileName, size_t length)
 	if (stat(_fileName, &fileInfo) != 0) {
 		//File does not exist.  Create it.
 		logInfo("EEPROM file %s does not exist, creating new file.\n", _fileName);
-		std::ofstream myFile(_fileName, std::ios::out | std::ios::binary);
-		if (!myFile) {
+		// Fill the eeprom with 1s
+		memset(_values, 0xFF, _length);
+		_dirty = true;
+		if (flush() != 0) {
 			logError("Unable to create config file %s.\n", _fileName);
 			return -1;
 		}
-		// Fill the eeprom with 1s
-		for (size_t i = 0; i < _length; ++i) {
-			_values[i] = 0xFF;
-		}
-		myFile.write((const char*)_values, _length);
-		myFile.close();
-	} else if (fileInfo.st_size < 0 || (size_t)fileInfo.st_size != _length) {
+		return 0;
+	}
+
+	if (fileInfo.st_size < 0 || (size_t)fileInfo.st_size != _length) {
 		logError("EEPROM file %s is not the correct size of %zu.  Please remove the file and a new one will be created.\n",
 		         _fileName, _length);
 		destroy();
 		return -1;
-	} else {
-		//Read config into local memory.
-		std::ifstream myFile(_fileName, std::ios::in | std::ios::binary);
-		if (!myFile) {
-			logError("Unable to open EEPROM file %s for reading.\n", _fileName);
-			return -1;
+	}
+
+	//Read config into local memory.
+	if ((fd = open(_fileName, O_RDONLY | O_CLOEXEC)) == -1) {
+		logError("Unable to open EEPROM file %s for reading.\n", _fileName);
+		return -1;
+	}
+	if (readAll(fd, _values, _length) != 0) {
+		logError("Unable to read EEPROM file %s.\n", _fileName);
+		close(fd);
+		return -1;
+	}
+	close(fd);
+
+	const std::string checksumName = std::string(_fileName) + SOFTEEPROM_CHECKSUM_SUFFIX;
+	if ((fd = open(checksumName.c_str(), O_RDONLY | O_CLOEXEC)) == -1 ||
+	        readAll(fd, &checksum, sizeof(checksum)) != 0 || checksum.magic != SOFTEEPROM_MAGIC ||
+	        !checksumMatchesFile(&checksum, &fileInfo)) {
+		// No checksum yet, or the file was written by an older version or right before a crash
+		logInfo("EEPROM file %s has no current checksum, adding one.\n", _fileName);
+		if (fd != -1) {
+			close(fd);
 		}
-		myFile.read((char*)_values, _length);
-		myFile.close();
+		_dirty = true;
+		(void)flush();
+		return 0;
+	}
+	close(fd);
+
+	if (checksum.crc != crc32(_values, _length)) {
+		logError("EEPROM file %s is corrupted.  Please restore or remove the file and a new one will be created.\n",
+		         _fileName);
+		destroy();
+		return -1;
 	}
 
 	return 0;
@@ -96,6 +251,7 @@ int SoftEeprom::init(const char *fileName, size_t length)
 
 void SoftEeprom::destroy()
 {
+	// Unsaved changes are dropped, see flush()
 	if (_values) {
 		delete[] _values;
 		_values = NULL;
@@ -105,6 +261,7 @@ void SoftEeprom::destroy()
 		_fileName = NULL;
 	}
 	_length = 0;
+	_dirty = false;
 }
 
 void SoftEeprom::readBlock(void* buf, void* addr, size_t length)
@@ -137,14 +294,14 @@ void SoftEeprom::writeBlock(void* buf, void* addr, size_t length)
 
 		memcpy(_values+offs, buf, length);
 
-		std::ofstream myFile(_fileName, std::ios::out | std::ios::in | std::ios::binary);
-		if (!myFile) {
-			logError("Unable to write config to file %s.\n", _fileName);
-			return;
+		// Batch changes, routing updates tend to come in bursts
+		if (!_dirty) {
+			_dirty = true;
+			_dirtySince = monotonicMs();
+		}
+		if (_flushDelay == 0) {
+			(void)flush();
 		}
-		myFile.seekp(offs);
-		myFile.write((const char*)buf, length);
-		myFile.close();
 	}
 }
 
@@ -163,6 +320,75 @@ void SoftEeprom::writeByte(int addr, uint8_t value)
 	}
 }
 
+void SoftEeprom::setFlushDelay(uint32_t ms)
+{
+	_flushDelay = ms;
+}
+
+uint32_t SoftEeprom::sync()
+{
+	if (!_dirty) {
+		return UINT32_MAX;
+	}
+
+	const uint32_t elapsed = monotonicMs() - _dirtySince;
+	if (elapsed < _flushDelay) {
+		return _flushDelay - elapsed;
+	}
+	if (flush() != 0) {
+		// Retry after another delay
+		_dirtySince = monotonicMs();
+		return _flushDelay;
+	}
+
+	return UINT32_MAX;
+}
+
+int SoftEeprom::flush()
+{
+	struct stat fileInfo;
+	struct softEepromChecksum checksum;
+	struct iovec iov;
+	int fd;
+
+	if (!_dirty) {
+		return 0;
+	}
+
+	iov.iov_base = _values;
+	iov.iov_len = _length;
+	if (replaceFile(_fileName, &iov, 1, &fileInfo) != 0) {
+		return -1;
+	}
+
+	// A crash before the checksum is replaced leaves a checksum that does not match the
+	// data file's mtime, init() takes that for a file written by another version
+	memset(&checksum, 0, sizeof(checksum));
+	checksum.magic = SOFTEEPROM_MAGIC;
+	checksum.crc = crc32(_values, _length);
+	checksum.mtimeSec = fileInfo.st_mtim.tv_sec;
+	checksum.mtimeNsec = fileInfo.st_mtim.tv_nsec;
+	checksum.size = fileInfo.st_size;
+	iov.iov_base = &checksum;
+	iov.iov_len = sizeof(checksum);
+	const std::string checksumName = std::string(_fileName) + SOFTEEPROM_CHECKSUM_SUFFIX;
+	if (replaceFile(checksumName.c_str(), &iov, 1, &fileInfo) != 0) {
+		return -1;
+	}
+
+	// Make the renames themselves durable
+	const char *slash = strrchr(_fileName, '/');
+	const std::string dirName = slash == NULL ? "." : slash == _fileName ? "/" :
+	                            std::string(_fileName, slash - _fileName);
+	if ((fd = open(dirName.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)) != -1) {
+		(void)fsync(fd);
+		close(fd);
+	}
+
+	_dirty = false;
+	return 0;
+}
+
 SoftEeprom& SoftEeprom::operator=(const SoftEeprom& other)
 {
 	if (this != &other) {
@@ -176,6 +402,9 @@ SoftEeprom& SoftEeprom::operator=(const SoftEeprom& other)
 		for (size_t i = 0; i < _length; ++i) {
 			_values[i] = other._values[i];
 		}
+		_dirty = other._dirty;
+		_dirtySince = other._dirtySince;
+		_flushDelay = other._flushDelay;
 	}
 	return *this;
 }
@@ -19,13 +19,15 @@
 
 /**
 * This a software emulation of EEPROM that uses a file for data storage.
-* A copy of the eeprom values are also held in memory for faster reading.
+* The eeprom values are held in memory, changes are written back in batches by
+* replacing the file atomically. A checksum kept next to the file detects corruption.
 */
 
 #ifndef SoftEeprom_h
 #define SoftEeprom_h
 
 #include <stdint.h>
+#include <stddef.h>
 
 /**
  * SoftEeprom class
@@ -57,6 +59,7 @@ public:
 	/**
 	 * @brief Clear all allocated memory variables.
 	 *
+	 * Changes that have not been written back are lost, call flush() first.
 	 */
 	void destroy();
 	/**
@@ -89,6 +92,27 @@ public:
 	 * @param value to write.
 	 */
 	void writeByte(int addr, uint8_t value);
+	/**
+	 * @brief Set how long changes may stay in memory only.
+	 *
+	 * @param ms delay after the first unsaved change, 0 writes through.
+	 */
+	void setFlushDelay(uint32_t ms);
+	/**
+	 * @brief Write back changes whose flush delay has expired.
+	 *
+	 * @return ms until the next write-back is due, UINT32_MAX if there are no changes.
+	 */
+	uint32_t sync();
+	/**
+	 * @brief Write back all changes now.
+	 *
+	 * The file is replaced atomically, a crash leaves either the old or the new contents.
+	 * Costs two fsync() calls, one for the values and one for their checksum.
+	 *
+	 * @return 0 if SUCCESS or -1 if FAILURE.
+	 */
+	int flush();
 	/**
 	 * @brief Overloaded assign operator.
 	 *
@@ -99,6 +123,9 @@ private:
 	size_t _length; //!< @brief Eeprom max size.
 	char *_fileName; //!< @brief file where the eeprom values are stored.
 	uint8_t *_values; //!< @brief copy of the eeprom values held in memory for a faster reading.
+	bool _dirty; //!< @brief _values has changes not written to the file.
+	uint32_t _dirtySince; //!< @brief Time of the first unsaved change, monotonic ms.
+	uint32_t _flushDelay; //!< @brief How long changes may stay unsaved, in ms.
 };
 
 #endif
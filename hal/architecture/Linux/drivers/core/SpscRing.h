@@ -0,0 +1,89 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef SpscRing_h
+#define SpscRing_h
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * SpscRing class
+ * Bounded lock-free queue for exactly one producer and one consumer thread.
+ */
+template <class T, size_t N> class SpscRing
+{
+
+public:
+	/**
+	 * @brief SpscRing constructor.
+	 */
+	SpscRing() : head(0), tail(0) {}
+	/**
+	 * @brief Add an item, producer thread only.
+	 *
+	 * @param item to add.
+	 * @return @c false if the ring is full.
+	 */
+	bool push(const T &item)
+	{
+		const size_t h = head.load(std::memory_order_relaxed);
+		const size_t next = (h + 1) % (N + 1);
+		if (next == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		items[h] = item;
+		head.store(next, std::memory_order_release);
+		return true;
+	}
+	/**
+	 * @brief Remove the oldest item, consumer thread only.
+	 *
+	 * @param item to copy the oldest item to.
+	 * @return @c false if the ring is empty.
+	 */
+	bool pop(T &item)
+	{
+		const size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = items[t];
+		tail.store((t + 1) % (N + 1), std::memory_order_release);
+		return true;
+	}
+	/**
+	 * @brief Get the number of queued items, a snapshot if called by the other thread.
+	 *
+	 * @return number of items.
+	 */
+	size_t size() const
+	{
+		const size_t h = head.load(std::memory_order_acquire);
+		const size_t t = tail.load(std::memory_order_acquire);
+		return (h + N + 1 - t) % (N + 1);
+	}
+
+private:
+	T items[N + 1]; //!< @brief Storage, one slot stays free to tell full from empty.
+	alignas(64) std::atomic<size_t> head; //!< @brief Next slot to write, owned by the producer.
+	alignas(64) std::atomic<size_t> tail; //!< @brief Next slot to read, owned by the consumer.
+};
+
+#endif
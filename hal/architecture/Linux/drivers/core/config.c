@@ -60,6 +60,7 @@ int config_parse(const char *config_file)
 	conf.soft_hmac_key = NULL;
 	conf.soft_serial_key = NULL;
 	conf.aes_key = NULL;
+	conf.ota_cache_file = NULL;
 
 	while (fgets(buf, 1024, fptr)) {
 		if (buf[0] != '#' && buf[0] != 10 && buf[0] != 13) {
@@ -165,6 +166,11 @@ int config_parse(const char *config_file)
 					fclose(fptr);
 					return -1;
 				}
+			} else if (!strncmp(buf, "ota_cache_file=", 15)) {
+				if (_config_parse_string(&(buf[15]), "ota_cache_file", &conf.ota_cache_file)) {
+					fclose(fptr);
+					return -1;
+				}
 			} else {
 				logWarning("Unknown config option \"%s\".\n", buf);
 			}
@@ -210,6 +216,9 @@ void config_cleanup(void)
 	if (conf.aes_key) {
 		free(conf.aes_key);
 	}
+	if (conf.ota_cache_file) {
+		free(conf.ota_cache_file);
+	}
 }
 
 int _config_create(const char *config_file)
@@ -258,7 +267,14 @@ int _config_create(const char *config_file)
 	                            "#\n" \
 	                            "# To generate a AES key run mysgw with: --gen-aes-key\n" \
 	                            "# copy the new key in the line below and uncomment it.\n" \
-	                            "#aes_key=\n";
+	                            "#aes_key=\n" \
+	                            "\n" \
+	                            "# OTA cache settings\n" \
+	                            "# Note: The gateway must have been built with --my-ota-cache\n" \
+	                            "#       to use the option below.\n" \
+	                            "#\n" \
+	                            "# Keep the cached firmware images in this file, in memory if not set.\n" \
+	                            "#ota_cache_file=/var/cache/mysensors.ota\n";
 
 	myFile = fopen(config_file, "w");
 	if (!myFile) {
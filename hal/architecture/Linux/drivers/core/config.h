@@ -39,6 +39,7 @@ struct config {
 	char *soft_hmac_key;
 	char *soft_serial_key;
 	char *aes_key;
+	char *ota_cache_file;
 };
 
 extern struct config conf;
@@ -0,0 +1,240 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#include "eventloop.h"
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include "log.h"
+
+#define EVENTLOOP_MAX_EVENTS 16
+#define EVENTLOOP_MAX_LOOPS 4
+
+struct eventLoop {
+	int epollFd;
+	int wakeupFd;
+};
+
+static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t loopsMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct eventLoop loops[EVENTLOOP_MAX_LOOPS];
+static int loopCount = 0;
+static __thread int currentLoop = EVENTLOOP_MAIN;
+static __thread bool pending = false;
+
+static int eventLoopCreate(struct eventLoop *loop)
+{
+	struct epoll_event ev;
+
+	loop->epollFd = -1;
+	loop->wakeupFd = -1;
+	if ((loop->epollFd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		logError("epoll_create1: %s\n", strerror(errno));
+		return -1;
+	}
+	if ((loop->wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+		logError("eventfd: %s\n", strerror(errno));
+		return -1;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = loop->wakeupFd;
+	if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeupFd, &ev) == -1) {
+		logError("epoll_ctl: %s\n", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+static void eventLoopInit(void)
+{
+	(void)eventLoopCreate(&loops[EVENTLOOP_MAIN]);
+	loopCount = 1;
+}
+
+static struct eventLoop *eventLoopGet(void)
+{
+	pthread_once(&initOnce, eventLoopInit);
+	return &loops[currentLoop];
+}
+
+int eventLoopThreadInit(void)
+{
+	int loop = -1;
+
+	pthread_once(&initOnce, eventLoopInit);
+	pthread_mutex_lock(&loopsMutex);
+	if (loopCount < EVENTLOOP_MAX_LOOPS && eventLoopCreate(&loops[loopCount]) == 0) {
+		loop = loopCount++;
+		currentLoop = loop;
+	}
+	pthread_mutex_unlock(&loopsMutex);
+
+	return loop;
+}
+
+int eventLoopAdd(int fd)
+{
+	struct eventLoop *loop = eventLoopGet();
+	struct epoll_event ev;
+
+	if (loop->epollFd == -1 || fd < 0) {
+		return -1;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+		if (errno == EEXIST) {
+			return 0;
+		}
+		// Regular files and /dev/null are not pollable, these are always ready
+		logDebug("Unable to watch fd %d: %s\n", fd, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+void eventLoopRemove(int fd)
+{
+	struct eventLoop *loop = eventLoopGet();
+
+	if (loop->epollFd == -1 || fd < 0) {
+		return;
+	}
+	// Errors are expected if the fd was never registered
+	(void)epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+void eventLoopWakeup(void)
+{
+	eventLoopWakeupLoop(EVENTLOOP_MAIN);
+}
+
+void eventLoopWakeupLoop(int loop)
+{
+	const uint64_t one = 1;
+
+	pthread_once(&initOnce, eventLoopInit);
+	if (loop < 0 || loop >= loopCount || loops[loop].wakeupFd == -1) {
+		return;
+	}
+	// The counter only saturates if nobody waits, ignore EAGAIN
+	if (write(loops[loop].wakeupFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+		logError("eventLoopWakeup: %s\n", strerror(errno));
+	}
+}
+
+void eventLoopBlockSignals(void)
+{
+	sigset_t signals;
+
+	(void)sigfillset(&signals);
+	(void)pthread_sigmask(SIG_BLOCK, &signals, NULL);
+}
+
+void eventLoopPending(void)
+{
+	pending = true;
+}
+
+int eventLoopWait(uint32_t timeoutMs)
+{
+	struct eventLoop *loop = eventLoopGet();
+	struct epoll_event events[EVENTLOOP_MAX_EVENTS];
+	uint64_t count;
+	int timeout, n;
+
+	if (loop->epollFd == -1) {
+		// Fall back to a fixed delay, better than spinning
+		usleep(10000);
+		return 0;
+	}
+
+	if (pending) {
+		// Only collect what is ready, buffered data waits to be processed
+		pending = false;
+		timeout = 0;
+	} else if (timeoutMs == EVENTLOOP_WAIT_FOREVER) {
+		timeout = -1;
+	} else if (timeoutMs > INT32_MAX) {
+		timeout = INT32_MAX;
+	} else {
+		timeout = (int)timeoutMs;
+	}
+
+	do {
+		n = epoll_wait(loop->epollFd, events, EVENTLOOP_MAX_EVENTS, timeout);
+	} while (n == -1 && errno == EINTR);
+
+	if (n == -1) {
+		logError("epoll_wait: %s\n", strerror(errno));
+		return -1;
+	}
+
+	for (int i = 0; i < n; i++) {
+		if (events[i].data.fd == loop->wakeupFd) {
+			// Reset the counter, the wake-up has been delivered
+			if (read(loop->wakeupFd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+				logError("eventLoopWait: %s\n", strerror(errno));
+			}
+		}
+	}
+
+	return n;
+}
+
+int eventLoopWaitWakeup(uint32_t timeoutMs)
+{
+	struct eventLoop *loop = eventLoopGet();
+	struct pollfd pfd;
+	uint64_t count;
+	int n;
+
+	if (loop->wakeupFd == -1) {
+		usleep(10000);
+		return 0;
+	}
+
+	pfd.fd = loop->wakeupFd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	do {
+		n = poll(&pfd, 1, timeoutMs > INT32_MAX ? -1 : (int)timeoutMs);
+	} while (n == -1 && errno == EINTR);
+
+	if (n == -1) {
+		logError("poll: %s\n", strerror(errno));
+		return -1;
+	}
+	if (n > 0 && read(loop->wakeupFd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+		logError("eventLoopWaitWakeup: %s\n", strerror(errno));
+	}
+
+	return n;
+}
@@ -0,0 +1,65 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ */
+
+#ifndef eventloop_h
+#define eventloop_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Waits forever in eventLoopWait()
+#define EVENTLOOP_WAIT_FOREVER UINT32_MAX
+// Id of the main thread's loop
+#define EVENTLOOP_MAIN 0
+
+// All functions below act on the calling thread's loop. Threads use the main loop
+// unless they call eventLoopThreadInit().
+
+// Gives the calling thread a loop of its own. Returns its id, -1 on error.
+int eventLoopThreadInit(void);
+// Registers a file descriptor, the loop wakes up when it becomes readable.
+int eventLoopAdd(int fd);
+// Unregisters a file descriptor, call it before closing the descriptor.
+void eventLoopRemove(int fd);
+// Wakes up a pending or the next eventLoopWait() of the main loop, safe to call from any thread.
+void eventLoopWakeup(void);
+// Same as eventLoopWakeup(), for the loop with the given id.
+void eventLoopWakeupLoop(int loop);
+// Blocks asynchronous signals in the calling thread, call it first thing in worker threads.
+// Signal handlers then always run on the main thread, which owns the main loop.
+void eventLoopBlockSignals(void);
+// Keeps the next eventLoopWait() from blocking, for data buffered in user space
+// that epoll cannot see. Cheaper than eventLoopWakeup().
+void eventLoopPending(void);
+// Blocks until a registered fd is readable, eventLoopWakeup() is called or timeout expires.
+// Returns the number of ready descriptors (wake-ups included), 0 on timeout or -1 on error.
+int eventLoopWait(uint32_t timeoutMs);
+// Blocks until eventLoopWakeup() is called for this loop or timeout expires, ignoring
+// registered fds. For a thread that cannot consume its input until another thread catches up.
+// Returns 1 when woken up, 0 on timeout or -1 on error.
+int eventLoopWaitWakeup(uint32_t timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
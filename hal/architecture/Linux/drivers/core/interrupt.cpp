@@ -33,6 +33,7 @@
 #include <errno.h>
 #include <sched.h>
 #include "log.h"
+#include "eventloop.h"
 
 struct ThreadArgs {
 	void (*func)();
@@ -82,6 +83,7 @@ void *interruptHandler(void *args)
 	void (*func)() = arguments->func;
 	delete arguments;
 
+	eventLoopBlockSignals();
 	(void)piHiPri(55);	// Only effective if we run as root
 
 	if ((fd = sysFds[gpioPin]) == -1) {
@@ -115,6 +117,8 @@ void *interruptHandler(void *args)
 		if (interruptsEnabled) {
 			pthread_mutex_unlock(&intMutex);
 			func();
+			// Let the main loop process whatever the handler queued
+			eventLoopWakeup();
 		} else {
 			pthread_mutex_unlock(&intMutex);
 		}
@@ -18,6 +18,7 @@
  */
 
 #include "log.h"
+#include "eventloop.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <sys/stat.h>
@@ -27,6 +28,32 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#define LOG_RECORD_SIZE 256 //!< Bytes per queued line, longer lines are truncated
+#define LOG_BATCH_SIZE 16384 //!< Output collected per write
+#define LOG_LINE_SIZE 1024 //!< Stack buffer of a synchronous line, longer lines are allocated
+
+/**
+ * A formatted line waiting for the writer thread. seq is the slot sequence number of
+ * the bounded multi-producer queue, see _logEnqueue().
+ */
+struct logRecord {
+	size_t seq;
+	time_t time;
+	uint8_t level;
+	uint16_t length;
+	char text[LOG_RECORD_SIZE - sizeof(size_t) - sizeof(time_t) - 2 * sizeof(uint16_t)];
+};
+
+/**
+ * Output being assembled for one destination.
+ */
+struct logBatch {
+	size_t length;
+	char data[LOG_BATCH_SIZE];
+};
 
 static const char *_log_level_colors[] = {
 	"\x1b[1;5;91m", "\x1b[1;91m", "\x1b[91m", "\x1b[31m", "\x1b[33m", "\x1b[34m", "\x1b[32m", "\x1b[36m"
@@ -44,6 +71,220 @@ static int _log_pipe_fd = -1;
 
 static FILE *_log_file_fp = NULL;
 
+// Writer side, owned by the writer thread or by whoever holds _log_sync_mutex
+static pthread_mutex_t _log_sync_mutex = PTHREAD_MUTEX_INITIALIZER;
+static time_t _log_date_time = -1;
+static char _log_date[16];
+static struct logBatch _log_file_batch;
+static struct logBatch _log_stderr_batch;
+
+// Asynchronous mode
+static struct logRecord *_log_ring = NULL;
+static size_t _log_ring_mask = 0;
+static size_t _log_head = 0;
+static size_t _log_tail = 0;
+static uint32_t _log_dropped = 0;
+static uint32_t _log_dropped_total = 0;
+static uint8_t _log_async = 0;
+static uint8_t _log_stop = 0;
+static uint8_t _log_writer_idle = 0;
+static sem_t _log_wakeup;
+static pthread_t _log_writer;
+
+static void _logBatchFlush(struct logBatch *batch, FILE *fp)
+{
+	if (batch->length > 0) {
+		(void)fwrite(batch->data, 1, batch->length, fp);
+		(void)fflush(fp);
+		batch->length = 0;
+	}
+}
+
+static void _logBatchAppend(struct logBatch *batch, FILE *fp, const char *prefix, size_t prefixLength,
+                            const char *text, size_t length)
+{
+	if (batch->length + prefixLength + length > sizeof(batch->data)) {
+		_logBatchFlush(batch, fp);
+		if (prefixLength + length > sizeof(batch->data)) {
+			(void)fwrite(prefix, 1, prefixLength, fp);
+			(void)fwrite(text, 1, length, fp);
+			return;
+		}
+	}
+	memcpy(batch->data + batch->length, prefix, prefixLength);
+	memcpy(batch->data + batch->length + prefixLength, text, length);
+	batch->length += prefixLength + length;
+}
+
+static void _logFlush(void)
+{
+	if (_log_file_fp != NULL) {
+		_logBatchFlush(&_log_file_batch, _log_file_fp);
+	}
+	_logBatchFlush(&_log_stderr_batch, stderr);
+}
+
+static void _logOutput(int level, time_t t, const char *text, size_t length)
+{
+	char prefix[64];
+	int prefixLength;
+
+	if (!_log_quiet || _log_file_fp != NULL) {
+		// The date only changes once a second, localtime() is expensive
+		if (t != _log_date_time) {
+			struct tm lt;
+			localtime_r(&t, &lt);
+			_log_date[strftime(_log_date, sizeof(_log_date), "%b %d %H:%M:%S", &lt)] = '\0';
+			_log_date_time = t;
+		}
+
+		if (_log_file_fp != NULL) {
+			prefixLength = snprintf(prefix, sizeof(prefix), "%s %-5s ", _log_date, _log_level_names[level]);
+			_logBatchAppend(&_log_file_batch, _log_file_fp, prefix, prefixLength, text, length);
+		}
+
+		if (!_log_quiet) {
+#ifdef LOG_DISABLE_COLOR
+			(void)_log_level_colors;
+			prefixLength = snprintf(prefix, sizeof(prefix), "%s %-5s ", _log_date, _log_level_names[level]);
+#else
+			prefixLength = snprintf(prefix, sizeof(prefix), "%s %s%-5s\x1b[0m ", _log_date,
+			                        _log_level_colors[level], _log_level_names[level]);
+#endif
+			_logBatchAppend(&_log_stderr_batch, stderr, prefix, prefixLength, text, length);
+		}
+	}
+
+	if (_log_syslog) {
+		syslog(level, "%.*s", (int)length, text);
+	}
+
+	if (_log_pipe) {
+		if (_log_pipe_fd < 0) {
+			_log_pipe_fd = open(_log_pipe_file, O_WRONLY | O_NONBLOCK);
+		}
+		if (_log_pipe_fd > 0) {
+			if (write(_log_pipe_fd, text, length) < 0) {
+				close(_log_pipe_fd);
+				_log_pipe_fd = -1;
+			}
+		}
+	}
+}
+
+static size_t _logFormat(char *buf, size_t size, const char *fmt, va_list args)
+{
+	int length = vsnprintf(buf, size, fmt, args);
+
+	if (length < 0) {
+		return 0;
+	}
+	if ((size_t)length >= size) {
+		// Truncated, keep the line terminated
+		length = size - 1;
+		buf[length - 1] = '\n';
+	}
+	return length;
+}
+
+static void _logEnqueue(int level, const char *fmt, va_list args)
+{
+	struct logRecord *rec;
+	size_t pos = __atomic_load_n(&_log_head, __ATOMIC_RELAXED);
+
+	// Bounded MPMC queue: a slot is free for the producer at pos once its seq equals pos
+	for (;;) {
+		rec = &_log_ring[pos & _log_ring_mask];
+		const size_t seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+		const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&_log_head, &pos, pos + 1, 1, __ATOMIC_RELAXED,
+			                                __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// Full, never block the caller
+			__atomic_add_fetch(&_log_dropped, 1, __ATOMIC_RELAXED);
+			return;
+		} else {
+			pos = __atomic_load_n(&_log_head, __ATOMIC_RELAXED);
+		}
+	}
+
+	rec->time = time(NULL);
+	rec->level = level;
+	rec->length = _logFormat(rec->text, sizeof(rec->text), fmt, args);
+	__atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+
+	if (__atomic_exchange_n(&_log_writer_idle, 0, __ATOMIC_SEQ_CST)) {
+		sem_post(&_log_wakeup);
+	}
+}
+
+static struct logRecord *_logPeek(void)
+{
+	struct logRecord *rec = &_log_ring[_log_tail & _log_ring_mask];
+
+	if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != _log_tail + 1) {
+		return NULL;
+	}
+	return rec;
+}
+
+static void _logRelease(struct logRecord *rec)
+{
+	__atomic_store_n(&rec->seq, _log_tail + _log_ring_mask + 1, __ATOMIC_RELEASE);
+	_log_tail++;
+}
+
+static void *_logWriterMain(void *arg)
+{
+	struct logRecord *rec;
+	char text[64];
+
+	(void)arg;
+	// Signals are left to the main thread
+	eventLoopBlockSignals();
+	for (;;) {
+		while ((rec = _logPeek()) != NULL) {
+			_logOutput(rec->level, rec->time, rec->text, rec->length);
+			_logRelease(rec);
+		}
+		const uint32_t dropped = __atomic_exchange_n(&_log_dropped, 0, __ATOMIC_RELAXED);
+		if (dropped > 0) {
+			_log_dropped_total += dropped;
+			const int length = snprintf(text, sizeof(text), "%u log messages dropped\n", dropped);
+			_logOutput(LOG_WARNING, time(NULL), text, length);
+		}
+		_logFlush();
+
+		if (__atomic_load_n(&_log_stop, __ATOMIC_ACQUIRE)) {
+			break;
+		}
+		__atomic_store_n(&_log_writer_idle, 1, __ATOMIC_SEQ_CST);
+		if (_logPeek() != NULL || __atomic_load_n(&_log_dropped, __ATOMIC_RELAXED) > 0) {
+			__atomic_store_n(&_log_writer_idle, 0, __ATOMIC_SEQ_CST);
+			continue;
+		}
+		while (sem_wait(&_log_wakeup) == -1 && errno == EINTR) {
+		}
+	}
+
+	return NULL;
+}
+
+static void _logStopAsync(void)
+{
+	if (!_log_async) {
+		return;
+	}
+	// Lines still queued are written before the writer exits
+	__atomic_store_n(&_log_stop, 1, __ATOMIC_RELEASE);
+	sem_post(&_log_wakeup);
+	pthread_join(_log_writer, NULL);
+	_log_async = 0;
+}
+
 void logSetQuiet(uint8_t enable)
 {
 	_log_quiet = enable ? 1 : 0;
@@ -97,8 +338,55 @@ int logSetFile(char *file)
 	return 0;
 }
 
+int logSetAsync(unsigned int entries)
+{
+	size_t size = 1;
+
+	if (_log_async || entries == 0) {
+		return 0;
+	}
+
+	while (size < entries) {
+		size <<= 1;
+	}
+	_log_ring = (struct logRecord *)malloc(size * sizeof(struct logRecord));
+	if (_log_ring == NULL) {
+		return -1;
+	}
+	for (size_t i = 0; i < size; i++) {
+		_log_ring[i].seq = i;
+	}
+	_log_ring_mask = size - 1;
+	_log_head = _log_tail = 0;
+	_log_stop = 0;
+
+	if (sem_init(&_log_wakeup, 0, 0) != 0) {
+		free(_log_ring);
+		_log_ring = NULL;
+		return -1;
+	}
+	if (pthread_create(&_log_writer, NULL, _logWriterMain, NULL) != 0) {
+		sem_destroy(&_log_wakeup);
+		free(_log_ring);
+		_log_ring = NULL;
+		return -1;
+	}
+	_log_async = 1;
+	// Do not lose what was logged right before an exit()
+	atexit(_logStopAsync);
+
+	return 0;
+}
+
+uint32_t logDropped(void)
+{
+	return _log_dropped_total + __atomic_load_n(&_log_dropped, __ATOMIC_RELAXED);
+}
+
 void logClose(void)
 {
+	_logStopAsync();
+
 	if (_log_syslog) {
 		closelog();
 		_log_syslog = 0;
@@ -125,51 +413,41 @@ void logClose(void)
 
 void vlog(int level, const char *fmt, va_list args)
 {
+	char text[LOG_LINE_SIZE];
+	char *line = text;
+	va_list copy;
+
 	if (_log_level < level) {
 		return;
 	}
 
-	if (!_log_quiet || _log_file_fp != NULL) {
-		/* Get current time */
-		time_t t = time(NULL);
-		struct tm *lt = localtime(&t);
-
-		char date[16];
-		date[strftime(date, sizeof(date), "%b %d %H:%M:%S", lt)] = '\0';
-
-		if (_log_file_fp != NULL) {
-			fprintf(_log_file_fp, "%s %-5s ", date, _log_level_names[level]);
-			vfprintf(_log_file_fp, fmt, args);
-			fflush(_log_file_fp);
-		}
-
-		if (!_log_quiet) {
-#ifdef LOG_DISABLE_COLOR
-			(void)_log_level_colors;
-			fprintf(stderr, "%s %-5s ", date, _log_level_names[level]);
-			vfprintf(stderr, fmt, args);
-#else
-			fprintf(stderr, "%s %s%-5s\x1b[0m ", date, _log_level_colors[level], _log_level_names[level]);
-			vfprintf(stderr, fmt, args);
-#endif
-		}
-	}
-
-	if (_log_syslog) {
-		vsyslog(level, fmt, args);
+	if (_log_async) {
+		_logEnqueue(level, fmt, args);
+		return;
 	}
 
-	if (_log_pipe) {
-		if (_log_pipe_fd < 0) {
-			_log_pipe_fd = open(_log_pipe_file, O_WRONLY | O_NONBLOCK);
-		}
-		if (_log_pipe_fd > 0) {
-			if (vdprintf(_log_pipe_fd, fmt, args) < 0) {
-				close(_log_pipe_fd);
-				_log_pipe_fd = -1;
-			}
+	// Before logSetAsync() or after logClose(), format once and write right away.
+	// Lines are not limited in length here, only queued lines are.
+	va_copy(copy, args);
+	int length = vsnprintf(text, sizeof(text), fmt, args);
+	if (length < 0) {
+		length = 0;
+	} else if ((size_t)length >= sizeof(text)) {
+		line = (char *)malloc(length + 1);
+		if (line != NULL) {
+			length = vsnprintf(line, length + 1, fmt, copy);
+		} else {
+			line = text;
+			length = _logFormat(text, sizeof(text), fmt, copy);
 		}
-
+	}
+	va_end(copy);
+	pthread_mutex_lock(&_log_sync_mutex);
+	_logOutput(level, time(NULL), line, length);
+	_logFlush();
+	pthread_mutex_unlock(&_log_sync_mutex);
+	if (line != text) {
+		free(line);
 	}
 }
 
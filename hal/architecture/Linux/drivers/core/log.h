@@ -40,6 +40,12 @@ void logSetLevel(int level);
 void logSetSyslog(int options, int facility);
 int logSetPipe(char *pipe_file);
 int logSetFile(char *file);
+// Moves timestamping and output to a writer thread. vlog() then only formats the line into
+// a lock-free ring of the given number of entries, lines are dropped and counted when it is full.
+// Lines still queued are written by logClose() and on exit().
+int logSetAsync(unsigned int entries);
+// Number of lines dropped because the ring was full.
+uint32_t logDropped(void);
 void logClose(void);
 
 void vlog(int level, const char *fmt, va_list args);
@@ -27,19 +27,33 @@ void SHA256HMAC(uint8_t *dest, const uint8_t *key, size_t keyLength, const uint8
 	SHA256HMACResult(dest);
 }
 
-AES _aes;
-
 void AES128CBCInit(const uint8_t *key)
 {
-	_aes.set_key((byte *)key, 16);
+	AES128setKey(key);
 }
 
 void AES128CBCEncrypt(uint8_t *iv, uint8_t *buffer, const size_t dataLength)
 {
-	_aes.cbc_encrypt((byte *)buffer, (byte *)buffer, dataLength / 16, iv);
+	for (size_t block = 0; block < dataLength / AES128_BLOCK_LENGTH; block++) {
+		for (uint8_t i = 0; i < AES128_BLOCK_LENGTH; i++) {
+			iv[i] ^= buffer[i];
+		}
+		AES128encrypt(iv);
+		(void)memcpy((void *)buffer, (const void *)iv, AES128_BLOCK_LENGTH);
+		buffer += AES128_BLOCK_LENGTH;
+	}
 }
 
 void AES128CBCDecrypt(uint8_t *iv, uint8_t *buffer, const size_t dataLength)
 {
-	_aes.cbc_decrypt((byte *)buffer, (byte *)buffer, dataLength / 16, iv);
+	uint8_t cipher[AES128_BLOCK_LENGTH];
+	for (size_t block = 0; block < dataLength / AES128_BLOCK_LENGTH; block++) {
+		(void)memcpy((void *)cipher, (const void *)buffer, AES128_BLOCK_LENGTH);
+		AES128decrypt(buffer);
+		for (uint8_t i = 0; i < AES128_BLOCK_LENGTH; i++) {
+			buffer[i] ^= iv[i];
+		}
+		(void)memcpy((void *)iv, (const void *)cipher, AES128_BLOCK_LENGTH);
+		buffer += AES128_BLOCK_LENGTH;
+	}
 }
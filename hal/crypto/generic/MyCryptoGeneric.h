@@ -21,7 +21,7 @@
 #define MyCryptoGeneric_h
 
 #include "hal/crypto/MyCryptoHAL.h"
-#include "hal/crypto/generic/drivers/AES/AES.cpp"
+#include "hal/crypto/generic/drivers/AES128/aes128.cpp"
 #include "hal/crypto/generic/drivers/SHA256/sha256.cpp"
 #include "hal/crypto/generic/drivers/HMAC_SHA256/hmac_sha256.cpp"
 
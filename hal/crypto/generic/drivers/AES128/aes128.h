@@ -0,0 +1,60 @@
+/*
+* The MySensors Arduino library handles the wireless radio link and protocol
+* between your home built sensors/actuators and HA controller of choice.
+* The sensors forms a self healing radio network with optional repeaters. Each
+* repeater and gateway builds a routing tables in EEPROM which keeps track of the
+* network topology allowing messages to be routed to nodes.
+*
+* Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+* Copyright (C) 2013-2020 Sensnology AB
+* Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+*
+* Documentation: http://www.mysensors.org
+* Support Forum: http://forum.mysensors.org
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+*/
+
+#ifndef _AES128_H_
+#define _AES128_H_
+
+#define AES128_BLOCK_LENGTH 16	//!< AES128_BLOCK_LENGTH
+#define AES128_ROUNDS 10	//!< AES128_ROUNDS
+#define AES128_KEY_WORDS (4 * (AES128_ROUNDS + 1))	//!< AES128_KEY_WORDS
+
+#if defined(__linux__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AES128_AESNI	//!< AES-NI dispatch
+#elif defined(__linux__) && defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define AES128_ARMV8	//!< ARMv8 crypto extensions dispatch
+#endif
+
+/**
+* @brief round keys, columns stored as little endian words
+*/
+typedef struct {
+	uint32_t enc[AES128_KEY_WORDS];	//!< encryption round keys
+	uint32_t dec[AES128_KEY_WORDS];	//!< decryption round keys (equivalent inverse cipher)
+} _AES128keySchedule_t;
+
+/**
+* @brief Expand the key into the encryption and decryption round keys
+*
+* Uses AES-NI or the ARMv8 crypto extensions for the following calls when the CPU has them.
+* @param key AES encryption key, 16 bytes
+*/
+void AES128setKey(const uint8_t *key);
+/**
+* @brief Encrypt one block in place with the key set by @ref AES128setKey()
+* @param block Block to encrypt, 16 bytes
+*/
+void AES128encrypt(uint8_t *block);
+/**
+* @brief Decrypt one block in place with the key set by @ref AES128setKey()
+* @param block Block to decrypt, 16 bytes
+*/
+void AES128decrypt(uint8_t *block);
+
+#endif
@@ -100,6 +100,12 @@ uint8_t _packet_len;
 unsigned char _packet_from;
 bool _packet_received;
 
+// Bytes read while a received packet waits to be picked up, one frame fits
+#define RS485_RX_BUFFER_SIZE (MY_RS485_SOH_COUNT + 8 + MY_RS485_MAX_MESSAGE_LENGTH)
+uint8_t _rxBuffer[RS485_RX_BUFFER_SIZE];
+uint8_t _rxBufferStart;
+uint8_t _rxBufferCount;
+
 // Packet wrapping characters, defined in standard ASCII table
 #define SOH 1
 #define STX 2
@@ -129,13 +135,27 @@ void _serialReset()
 bool _serialProcess()
 {
 	unsigned char i;
-	if (!_dev.available()) {
+	// Do not parse over the last packet before it is picked up, but keep reading so the
+	// hardware serial buffer does not overflow
+	if (_packet_received) {
+		while (_rxBufferCount < RS485_RX_BUFFER_SIZE && _dev.available()) {
+			_rxBuffer[(_rxBufferStart + _rxBufferCount++) % RS485_RX_BUFFER_SIZE] = _dev.read();
+		}
+		return false;
+	}
+	if (!_rxBufferCount && !_dev.available()) {
 		return false;
 	}
 
-	while(_dev.available()) {
+	while(_rxBufferCount || _dev.available()) {
 		char inch;
-		inch = _dev.read();
+		if (_rxBufferCount) {
+			inch = _rxBuffer[_rxBufferStart];
+			_rxBufferStart = (_rxBufferStart + 1) % RS485_RX_BUFFER_SIZE;
+			_rxBufferCount--;
+		} else {
+			inch = _dev.read();
+		}
 
 		switch(_recPhase) {
 
@@ -247,6 +267,11 @@ bool transportSend(const uint8_t to, const void* data, const uint8_t len, const
 	unsigned char i;
 	unsigned char cs = 0;
 
+	// The receiver drops anything that does not fit its buffer
+	if (len >= MY_RS485_MAX_MESSAGE_LENGTH) {
+		return false;
+	}
+
 	// This is how many times to try and transmit before failing.
 	unsigned char timeout = 10;
 
@@ -276,26 +301,31 @@ bool transportSend(const uint8_t to, const void* data, const uint8_t len, const
 	delayMicroseconds(5);
 #endif
 
+	// Assemble the whole frame first, so it goes out with a single write
+	uint8_t frame[MY_RS485_SOH_COUNT + 8 + MY_RS485_MAX_MESSAGE_LENGTH];
+	uint8_t pos = 0;
+
 	// Start of header by writing multiple SOH
 	for(byte w=0; w<MY_RS485_SOH_COUNT; w++) {
-		_dev.write(SOH);
+		frame[pos++] = SOH;
 	}
-	_dev.write(to);  // Destination address
+	frame[pos++] = to;  // Destination address
 	cs += to;
-	_dev.write(_nodeId); // Source address
+	frame[pos++] = _nodeId; // Source address
 	cs += _nodeId;
-	_dev.write(ICSC_SYS_PACK);  // Command code
+	frame[pos++] = ICSC_SYS_PACK;  // Command code
 	cs += ICSC_SYS_PACK;
-	_dev.write(len);      // Length of text
+	frame[pos++] = len;      // Length of text
 	cs += len;
-	_dev.write(STX);      // Start of text
+	frame[pos++] = STX;      // Start of text
 	for(i=0; i<len; i++) {
-		_dev.write(datap[i]);      // Text bytes
+		frame[pos++] = datap[i];      // Text bytes
 		cs += datap[i];
 	}
-	_dev.write(ETX);      // End of text
-	_dev.write(cs);
-	_dev.write(EOT);
+	frame[pos++] = ETX;      // End of text
+	frame[pos++] = cs;
+	frame[pos++] = EOT;
+	_dev.write(frame, pos);
 
 #if defined(MY_RS485_DE_PIN)
 #ifdef __PIC32MX__
@@ -0,0 +1,112 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ *
+ * Times AES-128 block encryption and decryption of the crypto HAL against the byte oriented
+ * AES class used before. Checks the FIPS-197 test vector and prints the time per block once
+ * after startup.
+ */
+#define MY_GATEWAY_SERIAL
+
+#include <MySensors.h>
+// byte oriented AES used before, kept here for comparison
+#include <hal/crypto/generic/drivers/AES/AES.cpp>
+
+#define BENCHMARK_ITERATIONS (1000ul)
+
+// FIPS-197 appendix C.1
+static const uint8_t benchmarkKey[N_BLOCK] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t benchmarkPlain[N_BLOCK] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t benchmarkCipher[N_BLOCK] = {
+	0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+static void report(const __FlashStringHelper *name, const uint32_t startUS)
+{
+	Serial.print(name);
+	Serial.print((micros() - startUS) * 1000ul / BENCHMARK_ITERATIONS);
+	Serial.println(F(" ns/block"));
+}
+
+static void check(const __FlashStringHelper *name, const uint8_t *block, const uint8_t *expected)
+{
+	Serial.print(name);
+	Serial.println(memcmp(block, expected, N_BLOCK) ? F("FAIL") : F("OK"));
+}
+
+void setup()
+{
+	AES aes;
+	uint8_t key[N_BLOCK];
+	uint8_t iv[N_BLOCK];
+	uint8_t block[N_BLOCK];
+	uint8_t result[N_BLOCK] = { 0 };
+	uint32_t startUS;
+
+	// a single CBC block with a zero IV is the plain block cipher
+	(void)memcpy(key, benchmarkKey, sizeof(key));
+	AES128CBCInit(key);
+	(void)memset(iv, 0, sizeof(iv));
+	(void)memcpy(block, benchmarkPlain, sizeof(block));
+	AES128CBCEncrypt(iv, block, sizeof(block));
+	check(F("encrypt vector: "), block, benchmarkCipher);
+	(void)memset(iv, 0, sizeof(iv));
+	AES128CBCDecrypt(iv, block, sizeof(block));
+	check(F("decrypt vector: "), block, benchmarkPlain);
+	(void)aes.set_key(key, sizeof(key));
+	(void)memcpy(block, benchmarkPlain, sizeof(block));
+	(void)aes.encrypt(block, result);
+	check(F("encrypt vector before: "), result, benchmarkCipher);
+
+	startUS = micros();
+	for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		(void)aes.encrypt(block, result);
+		(void)memcpy(block, result, sizeof(block));
+	}
+	report(F("encrypt before: "), startUS);
+
+	startUS = micros();
+	for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		(void)aes.decrypt(block, result);
+		(void)memcpy(block, result, sizeof(block));
+	}
+	report(F("decrypt before: "), startUS);
+
+	startUS = micros();
+	for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		AES128CBCEncrypt(iv, block, sizeof(block));
+	}
+	report(F("encrypt after: "), startUS);
+
+	startUS = micros();
+	for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		AES128CBCDecrypt(iv, block, sizeof(block));
+	}
+	report(F("decrypt after: "), startUS);
+}
+
+void loop()
+{
+}
@@ -0,0 +1,130 @@
+/*
+ * The MySensors Arduino library handles the wireless radio link and protocol
+ * between your home built sensors/actuators and HA controller of choice.
+ * The sensors forms a self healing radio network with optional repeaters. Each
+ * repeater and gateway builds a routing tables in EEPROM which keeps track of the
+ * network topology allowing messages to be routed to nodes.
+ *
+ * Created by Henrik Ekblad <henrik.ekblad@mysensors.org>
+ * Copyright (C) 2013-2020 Sensnology AB
+ * Full contributor list: https://github.com/mysensors/MySensors/graphs/contributors
+ *
+ * Documentation: http://www.mysensors.org
+ * Support Forum: http://forum.mysensors.org
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ *******************************
+ *
+ * DESCRIPTION
+ *
+ * Times the serial protocol parser and formatter against the strtok_r()/atoi() parser and
+ * snprintf_P() formatter used before. Prints the time per message once after startup.
+ */
+#define MY_GATEWAY_SERIAL
+
+#include <MySensors.h>
+
+#define BENCHMARK_ITERATIONS (1000ul)
+
+static const char benchmarkLine[] = "12;6;1;0;0;23.5\n";
+
+// Parser used before, kept here for comparison
+static bool legacySerial2MyMessage(MyMessage &message, char *inputString)
+{
+	char *str, *p;
+	uint8_t index = 0;
+	mysensors_command_t command = C_INVALID_7;
+	message.setSender(GATEWAY_ADDRESS);
+	message.setLast(GATEWAY_ADDRESS);
+	message.setEcho(false);
+
+	for (str = strtok_r(inputString, ";", &p); str && index < 5;
+	        str = strtok_r(NULL, ";", &p), index++) {
+		switch (index) {
+		case 0:
+			message.setDestination(atoi(str));
+			break;
+		case 1:
+			message.setSensor(atoi(str));
+			break;
+		case 2:
+			command = static_cast<mysensors_command_t>(atoi(str));
+			message.setCommand(command);
+			break;
+		case 3:
+			message.setRequestEcho(atoi(str) ? 1 : 0);
+			break;
+		case 4:
+			message.setType(atoi(str));
+			break;
+		}
+	}
+	if (str == NULL) {
+		message.set((uint8_t)0);
+	} else {
+		const uint8_t lastCharacter = strlen(str) - 1;
+		if (str[lastCharacter] == '\r' || str[lastCharacter] == '\n') {
+			str[lastCharacter] = '\0';
+		}
+		message.set(str);
+	}
+	return (index == 5);
+}
+
+// Formatter used before, kept here for comparison
+static size_t legacyMyMessage2Serial(const MyMessage &message, char *buffer)
+{
+	char payload[MAX_PAYLOAD_SIZE * 2 + 1];
+	return snprintf_P(buffer, MY_GATEWAY_MAX_SEND_LENGTH,
+	                  PSTR("%" PRIu8 ";%" PRIu8 ";%" PRIu8 ";%" PRIu8 ";%" PRIu8 ";%s\n"),
+	                  message.getSender(), message.getSensor(), message.getCommand(), message.isEcho(),
+	                  message.getType(), message.getString(payload));
+}
+
+static void report(const __FlashStringHelper *name, const uint32_t startUS)
+{
+	Serial.print(name);
+	Serial.print((micros() - startUS) * 1000ul / BENCHMARK_ITERATIONS);
+	Serial.println(F(" ns/msg"));
+}
+
+void setup()
+{
+	MyMessage message;
+	char line[sizeof(benchmarkLine)];
+	char buffer[MY_GATEWAY_MAX_SEND_LENGTH];
+	uint32_t startUS;
+
+	startUS = micros();
+	for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		(void)memcpy(line, benchmarkLine, sizeof(line));
+		(void)legacySerial2MyMessage(message, line);
+	}
+	report(F("parse before: "), startUS);
+
+	startUS = micros();
+	for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		(void)memcpy(line, benchmarkLine, sizeof(line));
+		(void)protocolParseSerial(message, line);
+	}
+	report(F("parse after: "), startUS);
+
+	startUS = micros();
+	for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		(void)legacyMyMessage2Serial(message, buffer);
+	}
+	report(F("format before: "), startUS);
+
+	startUS = micros();
+	for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		(void)protocolFormatSerial(message, buffer, sizeof(buffer));
+	}
+	report(F("format after: "), startUS);
+}
+
+void loop()
+{
+}